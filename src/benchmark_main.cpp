@@ -0,0 +1,183 @@
+#include "ze_benchmark.hpp"
+#include "ze_cpu_profiler.hpp"
+#include "ze_micro_benchmark.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Runs headless, use a software driver with VK_ICD_FILENAMES (lavapipe, SwiftShader) on machines without a GPU
+static void usage(const char *program) {
+    std::cerr << "usage: " << program << " [options]\n"
+              << "  --mode M          frames, or a measure of one part : allocator, transform-math,\n"
+              << "                    transform-store, transform-dirty, draw-list, model-load (frames)\n"
+              << "  --count N         items of the allocator and transform-dirty (10000), transform-math,\n"
+              << "                    transform-store and draw-list (100000) modes, loads of model-load (5)\n"
+              << "  --objects N       copies of the model (100)\n"
+              << "  --lights N        point lights, clustered (6)\n"
+              << "  --frames N        measured frames (1000)\n"
+              << "  --warmup N        frames rendered before measuring (30)\n"
+              << "  --width N         render target width (800)\n"
+              << "  --height N        render target height (600)\n"
+              << "  --timestep S      simulated seconds per frame (1/60)\n"
+              << "  --record-threads N  workers recording secondary command buffers, 0 inline (0)\n"
+              << "  --frames-in-flight N  frames recorded while the GPU renders the previous ones (2)\n"
+              << "  --model PATH      model to copy, or to load in model-load (models/pumpkin_1.obj)\n"
+              << "  --camera-path P   camera keys file, built-in orbit when omitted\n"
+              << "  --output PATH     JSON report, - for the standard output (benchmark.json)\n"
+              << "  --cpu-trace PATH  chrome://tracing JSON of the CPU profiler scopes\n";
+}
+
+// - for the standard output
+static void writeReport(const std::string &outputPath, const std::function<void(std::ostream &)> &write) {
+    if (outputPath == "-") {
+        write(std::cout);
+        return;
+    }
+    std::ofstream output{outputPath};
+    if (!output.is_open()) {
+        throw std::runtime_error("failed to open file: " + outputPath);
+    }
+    write(output);
+}
+
+int main(int argc, char **argv) {
+    ze::ZeBenchmark::Config config{};
+    std::string mode{"frames"};
+    uint32_t count = 0;
+    std::string outputPath{"benchmark.json"};
+    std::string cpuTracePath;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string option{argv[i]};
+            if (option == "--help" || option == "-h") {
+                usage(argv[0]);
+                return EXIT_SUCCESS;
+            }
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("missing value for " + option);
+            }
+            std::string value{argv[++i]};
+            if (option == "--mode") mode = value;
+            else if (option == "--count") count = std::stoul(value);
+            else if (option == "--objects") config.objectCount = std::stoul(value);
+            else if (option == "--lights") config.lightCount = std::stoul(value);
+            else if (option == "--frames") config.frameCount = std::stoul(value);
+            else if (option == "--warmup") config.warmupFrameCount = std::stoul(value);
+            else if (option == "--width") config.width = std::stoul(value);
+            else if (option == "--height") config.height = std::stoul(value);
+            else if (option == "--timestep") config.timestep = std::stof(value);
+            else if (option == "--record-threads") config.recordThreadCount = std::stoul(value);
+            else if (option == "--frames-in-flight") config.framesInFlight = std::stoul(value);
+            else if (option == "--model") config.modelPath = value;
+            else if (option == "--camera-path") config.cameraPath = value;
+            else if (option == "--output") outputPath = value;
+            else if (option == "--cpu-trace") cpuTracePath = value;
+            else throw std::invalid_argument("unknown option " + option);
+        }
+        if (mode != "frames" && mode != "allocator" && mode != "transform-math" && mode != "transform-store" &&
+            mode != "transform-dirty" && mode != "draw-list" && mode != "model-load") {
+            throw std::invalid_argument("unknown mode " + mode);
+        }
+        if (config.framesInFlight == 0) {
+            throw std::invalid_argument("--frames-in-flight must be at least 1");
+        }
+    } catch(const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        if (mode == "allocator") {
+            bool verified = false;
+            writeReport(outputPath, [count, &verified](std::ostream &out) {
+                verified = ze::runAllocatorBenchmark(count != 0 ? count : 10000, out);
+            });
+            if (!verified) {
+                std::cerr << "an allocation lost its content while defragmenting\n";
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+        if (mode == "transform-math") {
+            bool passed = false;
+            writeReport(outputPath, [count, &passed](std::ostream &out) {
+                passed = ze::runTransformMathBenchmark(count != 0 ? count : 100000, out);
+            });
+            if (!passed) {
+                std::cerr << "composeTransforms is out of tolerance\n";
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+
+        if (mode == "transform-store") {
+            bool passed = false;
+            writeReport(outputPath, [count, &passed](std::ostream &out) {
+                passed = ze::runTransformStoreBenchmark(count != 0 ? count : 100000, out);
+            });
+            if (!passed) {
+                std::cerr << "ZeTransformStore matrices differ from the per object ones\n";
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+        if (mode == "transform-dirty") {
+            bool passed = false;
+            writeReport(outputPath, [count, &passed](std::ostream &out) {
+                passed = ze::runTransformDirtyCheck(count != 0 ? count : 10000, out);
+            });
+            if (!passed) {
+                std::cerr << "ZeTransformStore recomputed the wrong matrices\n";
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+        if (mode == "draw-list") {
+            bool identical = false;
+            writeReport(outputPath, [count, &identical](std::ostream &out) {
+                identical = ze::runDrawListBenchmark(count != 0 ? count : 100000, out);
+            });
+            if (!identical) {
+                std::cerr << "the draw list order differs from std::stable_sort\n";
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+        if (mode == "model-load") {
+            bool identical = false;
+            writeReport(outputPath, [&config, count, &identical](std::ostream &out) {
+                identical = ze::runModelLoadBenchmark(config.modelPath, count != 0 ? count : 5, out);
+            });
+            if (!identical) {
+                std::cerr << "the parallel model load differs from the serial one\n";
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+
+        ze::ZeBenchmark benchmark{config};
+        benchmark.run();
+        writeReport(outputPath, [&benchmark](std::ostream &out) { benchmark.writeJson(out); });
+        if (!cpuTracePath.empty()) {
+            std::ofstream trace{cpuTracePath};
+            if (!trace.is_open()) {
+                throw std::runtime_error("failed to open file: " + cpuTracePath);
+            }
+            ze::ZeCpuProfiler::writeChromeTrace(trace);
+            if (!trace) {
+                throw std::runtime_error("failed to write file: " + cpuTracePath);
+            }
+        }
+    } catch(const std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
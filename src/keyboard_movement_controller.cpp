@@ -1,5 +1,7 @@
 #include "keyboard_movement_controller.hpp"
 
+#include <utility>
+
 namespace ze {
     void KeyboardMovementController::moveInPlaneXZ(GLFWwindow *window, float delta, ze::ZeGameObject &gameObject) {
         glm::vec3 rotate{0};
@@ -8,14 +10,15 @@ namespace ze {
         if (glfwGetKey(window, keys.lookUp) == GLFW_PRESS) rotate.x += 1.0f;
         if (glfwGetKey(window, keys.lookDown) == GLFW_PRESS) rotate.x -= 1.0f;
 
+        // only touch the transform on input, writes mark it dirty
         if (glm::dot(rotate, rotate) > std::numeric_limits<float>::epsilon()) {
-            gameObject.transform.rotation += lookSpeed * delta * glm::normalize(rotate);
+            auto &rotation = gameObject.transform.rotation();
+            rotation += lookSpeed * delta * glm::normalize(rotate);
+            rotation.x = glm::clamp(rotation.x, -1.5f, 1.5f);
+            rotation.y = glm::mod(rotation.y, glm::two_pi<float>());
         }
 
-        gameObject.transform.rotation.x = glm::clamp(gameObject.transform.rotation.x, -1.5f, 1.5f);
-        gameObject.transform.rotation.y = glm::mod(gameObject.transform.rotation.y, glm::two_pi<float>());
-
-        float yaw = gameObject.transform.rotation.y;
+        float yaw = std::as_const(gameObject.transform).rotation().y;
         const glm::vec3 forwardDir{sin(yaw), 0.0f, cos(yaw)};
         const glm::vec3 rightDir{forwardDir.z, 0.0f, -forwardDir.x};
         const glm::vec3 upDir{0.0f, -1.0f, 0.0f};
@@ -29,7 +32,7 @@ namespace ze {
         if (glfwGetKey(window, keys.moveDown) == GLFW_PRESS) moveDir -= upDir;
 
         if (glm::dot(moveDir, moveDir) > std::numeric_limits<float>::epsilon()) {
-            gameObject.transform.translation += moveSpeed * delta * glm::normalize(moveDir);
+            gameObject.transform.translation() += moveSpeed * delta * glm::normalize(moveDir);
         }
 
 
@@ -3,18 +3,13 @@
 layout (location = 0) in vec2 fragOffset;
 layout (location = 0) out vec4 outColor;
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
-
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
     mat4 inverseView;
     vec4 ambientLightColor;  // RGB + intensity
-    PointLight pointLights[10]; // todo specialized constant
-    int numLights;
+    uvec4 clusterCount; // x tiles, y tiles, depth slices, number of lights
+    vec4 clusterDepth; // slice = log(view depth) * x + y
 } ubo;
 
 layout (push_constant) uniform Push {
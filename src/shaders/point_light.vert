@@ -10,18 +10,13 @@ const vec2 OFFSETS[6] = vec2[](
 
 layout (location = 0) out vec2 fragOffset;
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
-
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
     mat4 inverseView;
     vec4 ambientLightColor;  // RGB + intensity
-    PointLight pointLights[10]; // todo specialized constant
-    int numLights;
+    uvec4 clusterCount; // x tiles, y tiles, depth slices, number of lights
+    vec4 clusterDepth; // slice = log(view depth) * x + y
 } ubo;
 
 layout (push_constant) uniform Push {
@@ -7,8 +7,8 @@ layout (location = 2) in vec3 fragNormalWorld;
 layout (location = 0) out vec4 outColor;
 
 struct PointLight {
-    vec4 position;
-    vec4 color;
+    vec4 position; // w is range
+    vec4 color; // w is intensity
 };
 
 layout(set = 0, binding = 0) uniform GlobalUbo {
@@ -16,14 +16,22 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 view;
     mat4 inverseView;
     vec4 ambientLightColor;  // RGB + intensity
-    PointLight pointLights[10]; // todo specialized constant
-    int numLights;
+    uvec4 clusterCount; // x tiles, y tiles, depth slices, number of lights
+    vec4 clusterDepth; // slice = log(view depth) * x + y
 } ubo;
 
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
+layout(std430, set = 0, binding = 1) readonly buffer Lights {
+    PointLight lights[];
+};
+
+// offset in lightIndices and number of lights of each cluster
+layout(std430, set = 0, binding = 2) readonly buffer LightClusters {
+    uvec2 clusters[];
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer LightIndices {
+    uint lightIndices[];
+};
 
 void main() {
     vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
@@ -33,10 +41,21 @@ void main() {
     vec3 cameraPosWorld = ubo.inverseView[3].xyz;
     vec3 viewDirection = normalize(cameraPosWorld - fragPositionWorld);
 
-    for (int i = 0; i< ubo.numLights; i++) {
-        PointLight light = ubo.pointLights[i];
+    // the cluster of the fragment, as binned by LightClusterSystem
+    vec4 positionView = ubo.view * vec4(fragPositionWorld, 1.0);
+    vec4 positionClip = ubo.projection * positionView;
+    vec2 tile = (positionClip.xy / positionClip.w * 0.5 + 0.5) * vec2(ubo.clusterCount.xy);
+    float slice = log(positionView.z) * ubo.clusterDepth.x + ubo.clusterDepth.y;
+    ivec3 cluster = clamp(ivec3(floor(vec3(tile, slice))), ivec3(0), ivec3(ubo.clusterCount.xyz) - 1);
+    uvec2 lightList = clusters[(cluster.z * ubo.clusterCount.y + cluster.y) * ubo.clusterCount.x + cluster.x];
+
+    for (uint i = lightList.x; i < lightList.x + lightList.y; i++) {
+        PointLight light = lights[lightIndices[i]];
         vec3 directionToLight = light.position.xyz - fragPositionWorld;
-        float attenuation = 1.0 / dot(directionToLight, directionToLight); // attenuate by object distance squared
+        float distanceSquared = dot(directionToLight, directionToLight);
+        // attenuate by distance squared, faded out to zero at the light range
+        float falloff = clamp(1.0 - distanceSquared / (light.position.w * light.position.w), 0.0, 1.0);
+        float attenuation = falloff * falloff / distanceSquared;
         directionToLight = normalize(directionToLight);
 
         float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0);
@@ -4,35 +4,28 @@ layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec2 uv;
+// per instance
+layout(location = 4) in mat4 modelMatrix;
+layout(location = 8) in mat4 normalMatrix;
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 
-struct PointLight {
-    vec4 position;
-    vec4 color;
-};
-
 layout(set = 0, binding = 0) uniform GlobalUbo {
     mat4 projection;
     mat4 view;
     mat4 inverseView;
     vec4 ambientLightColor;  // RGB + intensity
-    PointLight pointLights[10]; // todo specialized constant
-    int numLights;
+    uvec4 clusterCount; // x tiles, y tiles, depth slices, number of lights
+    vec4 clusterDepth; // slice = log(view depth) * x + y
 } ubo;
 
-layout(push_constant) uniform Push {
-    mat4 modelMatrix;
-    mat4 normalMatrix;
-} push;
-
 void main() {
-    vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+    vec4 positionWorld = modelMatrix * vec4(position, 1.0);
     gl_Position = ubo.projection * ubo.view * positionWorld;
 
-    fragNormalWorld= normalize(mat3(push.normalMatrix) * normal);
+    fragNormalWorld= normalize(mat3(normalMatrix) * normal);
     fragPosWorld = positionWorld.xyz;
     fragColor = color;
 }
\ No newline at end of file
@@ -0,0 +1,174 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include "glm/glm.hpp"
+
+#include "light_cluster_system.hpp"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace ze {
+
+    // irradiance under which a light is ignored, sets the light ranges
+    static constexpr float LIGHT_CUTOFF = 0.01f;
+
+    LightClusterSystem::LightClusterSystem(uint32_t workerCount): workers{workerCount} {
+        clusters.resize(CLUSTER_COUNT);
+    }
+
+    size_t LightClusterSystem::maxFrameStorage(size_t lightCount) {
+        lightCount = std::max<size_t>(lightCount, 1);
+        return lightCount * sizeof(PointLight) +
+               CLUSTER_COUNT * sizeof(LightCluster) +
+               lightCount * CLUSTER_COUNT * sizeof(uint32_t);
+    }
+
+    int LightClusterSystem::slice(float depth) const {
+        int index = static_cast<int>(std::floor(std::log(depth) * sliceScale + sliceBias));
+        return glm::clamp(index, 0, static_cast<int>(CLUSTER_COUNT_Z) - 1);
+    }
+
+    void LightClusterSystem::update(FrameInfo &frameInfo, GlobalUbo &ubo) {
+        assert(frameInfo.frameRing != nullptr && "LightClusterSystem needs a frame ring");
+        const auto &projection = frameInfo.camera.getProjection();
+        assert(projection[2][3] == 1.0f && "LightClusterSystem needs a perspective projection");
+        const float near = -projection[3][2] / projection[2][2];
+        const float far = projection[3][2] / (1.0f - projection[2][2]);
+        // slice = log(depth / near) / log(far / near) * CLUSTER_COUNT_Z
+        const float logDepthRange = std::log(far / near);
+        sliceScale = static_cast<float>(CLUSTER_COUNT_Z) / logDepthRange;
+        sliceBias = -static_cast<float>(CLUSTER_COUNT_Z) * std::log(near) / logDepthRange;
+
+        lights.clear();
+        for (auto &kv: frameInfo.gameObjects) {
+            auto &obj = kv.second;
+            if (obj.pointLight == nullptr) continue;
+            const float intensity = obj.pointLight->lightIntensity;
+            // where the inverse square falloff reaches the cutoff
+            const float range = std::sqrt(intensity * glm::max(obj.color.r, glm::max(obj.color.g, obj.color.b)) / LIGHT_CUTOFF);
+            lights.push_back({
+                glm::vec4(obj.transform.translation(), range),
+                glm::vec4(obj.color, intensity)});
+        }
+        const auto lightCount = static_cast<uint32_t>(lights.size());
+        bounds.resize(lights.size());
+
+        const uint32_t taskCount = std::min(workers.getThreadCount() + 1, CLUSTER_COUNT_Z);
+        auto sliceBegin = [&](uint32_t task) { return task * CLUSTER_COUNT_Z / taskCount; };
+        workers.parallelFor(taskCount, [&](uint32_t task) {
+            computeBounds(frameInfo.camera, near, far,
+                          static_cast<uint32_t>(static_cast<uint64_t>(task) * lightCount / taskCount),
+                          static_cast<uint32_t>(static_cast<uint64_t>(task + 1) * lightCount / taskCount));
+        });
+        // a task owns the clusters of its slices, no synchronization between the tasks
+        workers.parallelFor(taskCount, [&](uint32_t task) {
+            binSlices(sliceBegin(task), sliceBegin(task + 1), false);
+        });
+
+        uint32_t indexCount = 0;
+        uint32_t litClusterCount = 0;
+        stats = Stats{lightCount, 0, 0.0f};
+        for (auto &cluster : clusters) {
+            cluster.offset = indexCount;
+            indexCount += cluster.count;
+            stats.maxClusterLights = std::max(stats.maxClusterLights, cluster.count);
+            if (cluster.count > 0) litClusterCount++;
+            // counted again by the fill pass
+            cluster.count = 0;
+        }
+        stats.averageClusterLights = litClusterCount > 0 ? static_cast<float>(indexCount) / static_cast<float>(litClusterCount) : 0.0f;
+
+        lightIndices.resize(indexCount);
+        workers.parallelFor(taskCount, [&](uint32_t task) {
+            binSlices(sliceBegin(task), sliceBegin(task + 1), true);
+        });
+
+        // empty arrays still need a valid binding range
+        auto lightData = frameInfo.frameRing->allocateStorage(std::max<size_t>(lights.size(), 1) * sizeof(PointLight));
+        auto clusterData = frameInfo.frameRing->allocateStorage(clusters.size() * sizeof(LightCluster));
+        auto indexData = frameInfo.frameRing->allocateStorage(std::max<size_t>(lightIndices.size(), 1) * sizeof(uint32_t));
+        std::memcpy(lightData.data, lights.data(), lights.size() * sizeof(PointLight));
+        std::memcpy(clusterData.data, clusters.data(), clusters.size() * sizeof(LightCluster));
+        std::memcpy(indexData.data, lightIndices.data(), lightIndices.size() * sizeof(uint32_t));
+        frameInfo.globalOffsets[GLOBAL_LIGHTS_BINDING] = lightData.offset;
+        frameInfo.globalOffsets[GLOBAL_LIGHT_CLUSTERS_BINDING] = clusterData.offset;
+        frameInfo.globalOffsets[GLOBAL_LIGHT_INDICES_BINDING] = indexData.offset;
+
+        ubo.clusterCount = glm::uvec4{CLUSTER_COUNT_X, CLUSTER_COUNT_Y, CLUSTER_COUNT_Z, lightCount};
+        ubo.clusterDepth = glm::vec4{sliceScale, sliceBias, 0.0f, 0.0f};
+    }
+
+    void LightClusterSystem::computeBounds(const ZeCamera &camera, float near, float far, uint32_t begin, uint32_t end) {
+        const auto &view = camera.getView();
+        const auto &projection = camera.getProjection();
+        // normalized device coordinates to tile, clamped to the grid
+        auto tile = [](float ndc, uint32_t count) {
+            int index = static_cast<int>(std::floor((ndc * 0.5f + 0.5f) * static_cast<float>(count)));
+            return glm::clamp(index, 0, static_cast<int>(count) - 1);
+        };
+
+        for (uint32_t i = begin; i < end; i++) {
+            auto &lightBounds = bounds[i];
+            const glm::vec3 center = glm::vec3(view * glm::vec4(glm::vec3(lights[i].position), 1.0f));
+            const float range = lights[i].position.w;
+            if (center.z + range < near || center.z - range > far) {
+                lightBounds = {glm::ivec3{0, 0, 1}, glm::ivec3{0}};
+                continue;
+            }
+            const float zMin = glm::max(center.z - range, near);
+            const float zMax = glm::min(center.z + range, far);
+
+            // the projection of the view space box around the sphere, x / z and y / z are extreme
+            // at its corners
+            glm::vec2 ndcMin{std::numeric_limits<float>::max()};
+            glm::vec2 ndcMax{std::numeric_limits<float>::lowest()};
+            for (float z : {zMin, zMax}) {
+                for (float dx : {-range, range}) {
+                    for (float dy : {-range, range}) {
+                        glm::vec2 ndc{
+                            projection[0][0] * (center.x + dx) / z,
+                            projection[1][1] * (center.y + dy) / z};
+                        ndcMin = glm::min(ndcMin, ndc);
+                        ndcMax = glm::max(ndcMax, ndc);
+                    }
+                }
+            }
+            if (ndcMax.x < -1.0f || ndcMin.x > 1.0f || ndcMax.y < -1.0f || ndcMin.y > 1.0f) {
+                lightBounds = {glm::ivec3{0, 0, 1}, glm::ivec3{0}};
+                continue;
+            }
+            lightBounds.min = {tile(ndcMin.x, CLUSTER_COUNT_X), tile(ndcMin.y, CLUSTER_COUNT_Y), slice(zMin)};
+            lightBounds.max = {tile(ndcMax.x, CLUSTER_COUNT_X), tile(ndcMax.y, CLUSTER_COUNT_Y), slice(zMax)};
+        }
+    }
+
+    void LightClusterSystem::binSlices(uint32_t sliceBegin, uint32_t sliceEnd, bool fill) {
+        if (!fill) {
+            for (uint32_t z = sliceBegin; z < sliceEnd; z++) {
+                for (uint32_t i = 0; i < CLUSTER_COUNT_X * CLUSTER_COUNT_Y; i++) {
+                    clusters[z * CLUSTER_COUNT_X * CLUSTER_COUNT_Y + i].count = 0;
+                }
+            }
+        }
+        // lights in order, the index lists do not depend on the number of workers
+        for (uint32_t light = 0; light < static_cast<uint32_t>(bounds.size()); light++) {
+            const auto &lightBounds = bounds[light];
+            const int zBegin = glm::max(lightBounds.min.z, static_cast<int>(sliceBegin));
+            const int zEnd = glm::min(lightBounds.max.z + 1, static_cast<int>(sliceEnd));
+            for (int z = zBegin; z < zEnd; z++) {
+                for (int y = lightBounds.min.y; y <= lightBounds.max.y; y++) {
+                    for (int x = lightBounds.min.x; x <= lightBounds.max.x; x++) {
+                        auto &cluster = clusters[(z * CLUSTER_COUNT_Y + y) * CLUSTER_COUNT_X + x];
+                        if (fill) {
+                            lightIndices[cluster.offset + cluster.count] = light;
+                        }
+                        cluster.count++;
+                    }
+                }
+            }
+        }
+    }
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../ze_camera.hpp"
+#include "../ze_frame_info.hpp"
+#include "../ze_thread_pool.hpp"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace ze {
+
+    // Bins the point lights into a grid of clusters (screen tiles split in exponential depth slices)
+    // so a fragment only shades the lights of its cluster. Binning runs on the CPU every frame, the
+    // depth slices are split between the workers. The lights, the clusters and their light index
+    // lists are written to the frame ring and bound as the dynamic storage buffers of the global set.
+    class LightClusterSystem {
+    public:
+        static constexpr uint32_t CLUSTER_COUNT_X = 16;
+        static constexpr uint32_t CLUSTER_COUNT_Y = 9;
+        static constexpr uint32_t CLUSTER_COUNT_Z = 24;
+        static constexpr uint32_t CLUSTER_COUNT = CLUSTER_COUNT_X * CLUSTER_COUNT_Y * CLUSTER_COUNT_Z;
+
+        // lights per cluster of the last update, the shading cost of a fragment
+        struct Stats {
+            uint32_t lightCount;
+            uint32_t maxClusterLights;
+            // over the clusters lit by at least one light
+            float averageClusterLights;
+        };
+
+        explicit LightClusterSystem(uint32_t workerCount = std::max(std::thread::hardware_concurrency(), 1u) - 1);
+
+        LightClusterSystem(const LightClusterSystem&) = delete;
+        LightClusterSystem &operator=(const LightClusterSystem&) = delete;
+
+        // writes the lights of the game objects and their clusters to the frame ring, sets the
+        // storage offsets of frameInfo and the cluster parameters of ubo. The camera needs a
+        // perspective projection
+        void update(FrameInfo &frameInfo, GlobalUbo &ubo);
+
+        const Stats &getStats() const { return stats; }
+
+        // frame ring bytes written by update() when every light reaches every cluster
+        static size_t maxFrameStorage(size_t lightCount);
+
+    private:
+        // as the std430 layout of the shaders
+        struct LightCluster {
+            uint32_t offset;
+            uint32_t count;
+        };
+
+        // cluster coordinates ranges, inclusive, empty when min.z > max.z
+        struct LightBounds {
+            glm::ivec3 min;
+            glm::ivec3 max;
+        };
+
+        void computeBounds(const ZeCamera &camera, float near, float far, uint32_t begin, uint32_t end);
+        // fill : false counts the lights of each cluster, true writes their indices
+        void binSlices(uint32_t sliceBegin, uint32_t sliceEnd, bool fill);
+        int slice(float depth) const;
+
+        // the calling thread takes a share of the work
+        ZeThreadPool workers;
+
+        float sliceScale{0.0f};
+        float sliceBias{0.0f};
+
+        std::vector<PointLight> lights;
+        std::vector<LightBounds> bounds;
+        std::vector<LightCluster> clusters;
+        std::vector<uint32_t> lightIndices;
+        Stats stats{};
+    };
+
+}
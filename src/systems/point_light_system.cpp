@@ -6,22 +6,17 @@
 #include "point_light_system.hpp"
 
 #include <stdexcept>
-#include <map>
 
 namespace ze {
 
-    struct PointLightPushConstants {
-        glm::vec4 position{};
-        glm::vec4 color{};
-        float radius;
-    };
-
     PointLightSystem::PointLightSystem(ZeDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout): zeDevice{device} {
         createPipelineLayout(globalSetLayout);
         createPipeline(renderPass);
     }
 
     PointLightSystem::~PointLightSystem() {
+        // the pipeline may still be compiling with the layout
+        zePipeline.reset();
         vkDestroyPipelineLayout(zeDevice.device(), pipelineLayout, nullptr);
     }
 
@@ -63,67 +58,73 @@ namespace ze {
                 );
     }
 
-    void PointLightSystem::update(ze::FrameInfo &frameInfo, GlobalUbo &ubo) {
+    void PointLightSystem::update(ze::FrameInfo &frameInfo) {
         auto rotateLight = glm::rotate(
                 glm::mat4(1.f),
                 frameInfo.frameTime,
                 {0.0f, -1.0f, 0.0f}
         );
 
-        int lightIndex = 0;
         for (auto& kv: frameInfo.gameObjects) {
             auto& obj = kv.second;
             if (obj.pointLight == nullptr) continue;
 
-            obj.transform.translation = glm::vec3(rotateLight *  glm::vec4(obj.transform.translation, 1.0f));
-
-            ubo.pointLights[lightIndex].position = glm::vec4(obj.transform.translation, 1.0f);
-            ubo.pointLights[lightIndex].color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-            lightIndex += 1;
+            auto &translation = obj.transform.translation();
+            translation = glm::vec3(rotateLight *  glm::vec4(translation, 1.0f));
         }
-        ubo.numLights = lightIndex;
     }
 
     void PointLightSystem::render(FrameInfo &frameInfo) {
         // sort lights
-        std::map<float, ZeGameObject::id_t > sorted;
+        drawList.clear();
+        billboards.clear();
+        const auto cameraPosition = frameInfo.camera.getPositin();
         for (auto& kv: frameInfo.gameObjects) {
-            auto &obj = kv.second;
+            const auto &obj = kv.second;
             if (obj.pointLight == nullptr) continue;
             /// calculate distance
-            auto offset = frameInfo.camera.getPositin() - obj.transform.translation;
+            auto offset = cameraPosition - obj.transform.translation();
             float disSquared = glm::dot(offset, offset);
-            sorted[disSquared] = obj.getId();
+            drawList.add(ZeDrawList::makeKey(disSquared), static_cast<uint32_t>(billboards.size()));
+            billboards.push_back({
+                glm::vec4(obj.transform.translation(), 1.0f),
+                glm::vec4(obj.color, obj.pointLight->lightIntensity),
+                obj.transform.scale().x});
         }
+        drawList.sort();
 
-        zePipeline->bind(frameInfo.commandBuffer);
-
-        vkCmdBindDescriptorSets(
-                frameInfo.commandBuffer,
-                VK_PIPELINE_BIND_POINT_GRAPHICS,
-                pipelineLayout,
-                0,
-                1,
-                &frameInfo.globalDescriptorSet,
-                0,
-                nullptr
-                );
+        auto record = [&](VkCommandBuffer commandBuffer) {
+            zePipeline->bind(commandBuffer);
 
-        for (auto it = sorted.begin(); it != sorted.end(); ++it) {
-            auto &obj = frameInfo.gameObjects.at(it->second);
-            PointLightPushConstants push{};
-            push.position = glm::vec4(obj.transform.translation, 1.0f);
-            push.color = glm::vec4(obj.color, obj.pointLight->lightIntensity);
-            push.radius = obj.transform.scale.x;
-            vkCmdPushConstants(
-                    frameInfo.commandBuffer,
+            vkCmdBindDescriptorSets(
+                    commandBuffer,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
                     pipelineLayout,
-                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
                     0,
-                    sizeof(PointLightPushConstants),
-                    &push
+                    1,
+                    &frameInfo.globalDescriptorSet,
+                    static_cast<uint32_t>(frameInfo.globalOffsets.size()),
+                    frameInfo.globalOffsets.data()
                     );
-            vkCmdDraw(frameInfo.commandBuffer, 6, 1, 0, 0);
+
+            for (const auto &item : drawList) {
+                vkCmdPushConstants(
+                        commandBuffer,
+                        pipelineLayout,
+                        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                        0,
+                        sizeof(PointLightPushConstants),
+                        &billboards[item.payload]
+                        );
+                vkCmdDraw(commandBuffer, 6, 1, 0, 0);
+            }
+        };
+
+        // a few draws, a single secondary buffer
+        if (frameInfo.recorder != nullptr) {
+            frameInfo.recorder->record(1, [&](uint32_t, VkCommandBuffer commandBuffer) { record(commandBuffer); });
+        } else {
+            record(frameInfo.commandBuffer);
         }
     }
 
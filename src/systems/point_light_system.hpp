@@ -5,12 +5,19 @@
 #include "../ze_device.hpp"
 #include "../ze_game_object.hpp"
 #include "../ze_frame_info.hpp"
+#include "../ze_draw_list.hpp"
 
 #include <memory>
 #include <vector>
 
 namespace ze {
 
+    struct PointLightPushConstants {
+        glm::vec4 position{};
+        glm::vec4 color{};
+        float radius;
+    };
+
     class PointLightSystem {
     public:
         PointLightSystem(ZeDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
@@ -19,7 +26,8 @@ namespace ze {
         PointLightSystem(const PointLightSystem&) = delete;
         PointLightSystem &operator=(const PointLightSystem&) = delete;
 
-        void update(FrameInfo &frameInfo, GlobalUbo &ubo);
+        // moves the lights, LightClusterSystem uploads them
+        void update(FrameInfo &frameInfo);
         void render(FrameInfo &frameInfo);
 
     private:
@@ -30,6 +38,10 @@ namespace ze {
 
         std::unique_ptr<ZePipeline> zePipeline;
         VkPipelineLayout  pipelineLayout;
+
+        // reused every frame, the billboards are blended back to front
+        ZeDrawList drawList;
+        std::vector<PointLightPushConstants> billboards;
     };
 
 }
\ No newline at end of file
@@ -5,14 +5,16 @@
 
 #include "simple_render_system.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <functional>
 #include <stdexcept>
 #include <array>
 
 namespace ze {
-    struct SimplePushConstantData {
-        glm::mat4 modelMatrix { 1.0f };
-        glm::mat4 normalMatrix { 1.0f };
-    };
+
+    // below this a secondary command buffer costs more than it saves
+    static constexpr size_t MIN_ITEMS_PER_SECONDARY = 512;
 
     SimpleRenderSystem::SimpleRenderSystem(ZeDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout): zeDevice{device} {
         createPipelineLayout(globalSetLayout);
@@ -20,23 +22,44 @@ namespace ze {
     }
 
     SimpleRenderSystem::~SimpleRenderSystem() {
+        // the pipeline may still be compiling with the layout
+        zePipeline.reset();
         vkDestroyPipelineLayout(zeDevice.device(), pipelineLayout, nullptr);
     }
 
-    void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
-        VkPushConstantRange pushConstantRange{};
-        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-        pushConstantRange.offset = 0;
-        pushConstantRange.size = sizeof(SimplePushConstantData);
+    std::vector<VkVertexInputBindingDescription> SimpleRenderSystem::InstanceData::getBindingDescription() {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+        bindingDescriptions[0].binding = 1;
+        bindingDescriptions[0].stride = sizeof(InstanceData);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        return bindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> SimpleRenderSystem::InstanceData::getAttributeDescription() {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{};
+
+        // a mat4 attribute takes one location per column, after the vertex attributes
+        for (uint32_t column = 0; column < 4; column++) {
+            attributeDescriptions.push_back({4 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+                                             static_cast<uint32_t>(offsetof(InstanceData, modelMatrix) + column * sizeof(glm::vec4))});
+        }
+        for (uint32_t column = 0; column < 4; column++) {
+            attributeDescriptions.push_back({8 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT,
+                                             static_cast<uint32_t>(offsetof(InstanceData, normalMatrix) + column * sizeof(glm::vec4))});
+        }
+
+        return attributeDescriptions;
+    }
 
+    void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
         std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout};
 
         VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
         pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
         pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
         pipelineLayoutCreateInfo.pSetLayouts = descriptorSetLayouts.data();
-        pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
-        pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+        pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
+        pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
         if (vkCreatePipelineLayout(zeDevice.device(), &pipelineLayoutCreateInfo, nullptr,&pipelineLayout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create pipeline layout");
         }
@@ -47,6 +70,12 @@ namespace ze {
 
         PipelineConfigInfo pipelineConfigInfo{};
         ZePipeline::defaultPipelineConfigInfo(pipelineConfigInfo);
+        auto instanceBindings = InstanceData::getBindingDescription();
+        auto instanceAttributes = InstanceData::getAttributeDescription();
+        pipelineConfigInfo.bindingDescriptions.insert(
+                pipelineConfigInfo.bindingDescriptions.end(), instanceBindings.begin(), instanceBindings.end());
+        pipelineConfigInfo.attributeDescriptions.insert(
+                pipelineConfigInfo.attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
         pipelineConfigInfo.renderPass = renderPass;
         pipelineConfigInfo.pipelineLayout = pipelineLayout;
         zePipeline = std::make_unique<ZePipeline>(
@@ -58,35 +87,94 @@ namespace ze {
     }
 
     void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo) {
-        zePipeline->bind(frameInfo.commandBuffer);
+        drawItems.clear();
+        boundingSpheres.clear();
+        for (auto& kv: frameInfo.gameObjects) {
+            auto& obj = kv.second;
+            if (obj.model == nullptr) continue;
+            const glm::mat4 &modelMatrix = obj.transform.mat4();
+            // world space sphere, scaled by the largest axis scale
+            const auto &bounds = obj.model->getBounds();
+            float scale = glm::max(glm::length(glm::vec3(modelMatrix[0])),
+                                   glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+            boundingSpheres.emplace_back(glm::vec3(modelMatrix * glm::vec4(bounds.center, 1.0f)), bounds.radius * scale);
+            drawItems.push_back({obj.model.get(), &obj, modelMatrix});
+        }
+
+        visibility.resize(drawItems.size());
+        const ZeFrustum frustum = frameInfo.camera.getFrustum();
+        uint32_t visibleCount = frustum.intersectSpheres(
+                boundingSpheres.data(), static_cast<uint32_t>(boundingSpheres.size()), visibility.data());
+        cullingStats.tested = static_cast<uint32_t>(drawItems.size());
+        cullingStats.culled = cullingStats.tested - visibleCount;
+
+        size_t kept = 0;
+        for (size_t i = 0; i < drawItems.size(); i++) {
+            if (visibility[i]) drawItems[kept++] = drawItems[i];
+        }
+        drawItems.resize(kept);
+        if (drawItems.empty()) {
+            return;
+        }
+
+        // objects sharing a model become a contiguous range of instances
+        std::sort(drawItems.begin(), drawItems.end(), [](const DrawItem &a, const DrawItem &b) {
+            return std::less<ZeModel *>{}(a.model, b.model);
+        });
+
+        assert(frameInfo.frameRing != nullptr && "SimpleRenderSystem needs a frame ring");
+        // vertex buffer offsets only need the attribute alignment
+        auto instances = frameInfo.frameRing->allocate(drawItems.size() * sizeof(InstanceData), alignof(InstanceData));
+        if (frameInfo.recorder == nullptr) {
+            recordRange(frameInfo, frameInfo.commandBuffer, instances, 0, drawItems.size());
+        } else {
+            // contiguous ranges of the sorted items, one per secondary buffer
+            size_t rangeCount = std::min<size_t>(
+                    frameInfo.recorder->getSlotCount(),
+                    (drawItems.size() + MIN_ITEMS_PER_SECONDARY - 1) / MIN_ITEMS_PER_SECONDARY);
+            size_t rangeSize = (drawItems.size() + rangeCount - 1) / rangeCount;
+            frameInfo.recorder->record(static_cast<uint32_t>(rangeCount), [&](uint32_t range, VkCommandBuffer commandBuffer) {
+                size_t first = range * rangeSize;
+                recordRange(frameInfo, commandBuffer, instances, first, std::min(first + rangeSize, drawItems.size()));
+            });
+        }
+    }
+
+    void SimpleRenderSystem::recordRange(FrameInfo &frameInfo, VkCommandBuffer commandBuffer, const ZeFrameRing::Allocation &instances,
+                                         size_t begin, size_t end) {
+        auto *instanceData = static_cast<InstanceData *>(instances.data);
+        for (size_t i = begin; i < end; i++) {
+            instanceData[i].modelMatrix = drawItems[i].modelMatrix;
+            instanceData[i].normalMatrix = drawItems[i].gameObject->transform.normalMatrix();
+        }
+
+        zePipeline->bind(commandBuffer);
 
         vkCmdBindDescriptorSets(
-                frameInfo.commandBuffer,
+                commandBuffer,
                 VK_PIPELINE_BIND_POINT_GRAPHICS,
                 pipelineLayout,
                 0,
                 1,
                 &frameInfo.globalDescriptorSet,
-                0,
-                nullptr
+                static_cast<uint32_t>(frameInfo.globalOffsets.size()),
+                frameInfo.globalOffsets.data()
                 );
 
-        for (auto& kv: frameInfo.gameObjects) {
-            auto& obj = kv.second;
-            if (obj.model == nullptr) continue;
-            SimplePushConstantData push{};
-            push.modelMatrix = obj.transform.mat4();
-            push.normalMatrix = obj.transform.normalMatrix();
-
-            vkCmdPushConstants(frameInfo.commandBuffer,
-                               pipelineLayout,
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               0,
-                               sizeof(SimplePushConstantData),
-                               &push);
-            obj.model->bind(frameInfo.commandBuffer);
-            obj.model->draw(frameInfo.commandBuffer);
+        VkBuffer buffers[] = { frameInfo.frameRing->getBuffer() };
+        VkDeviceSize offsets[] = { instances.offset };
+        vkCmdBindVertexBuffers(commandBuffer, 1, 1, buffers, offsets);
+
+        // instances keep their index in the whole frame, a model may be split across ranges
+        for (size_t first = begin; first < end;) {
+            ZeModel *model = drawItems[first].model;
+            size_t last = first + 1;
+            while (last < end && drawItems[last].model == model) last++;
+
+            model->bind(commandBuffer);
+            model->draw(commandBuffer, static_cast<uint32_t>(last - first), static_cast<uint32_t>(first));
+            first = last;
         }
     }
 
-}
\ No newline at end of file
+}
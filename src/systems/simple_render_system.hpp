@@ -3,6 +3,7 @@
 #include "../ze_camera.hpp"
 #include "../ze_pipeline.hpp"
 #include "../ze_device.hpp"
+#include "../ze_buffer.hpp"
 #include "../ze_game_object.hpp"
 #include "../ze_frame_info.hpp"
 
@@ -11,24 +12,58 @@
 
 namespace ze {
 
+    // Draws the game objects with a model, objects sharing a model are drawn with a single
+    // instanced draw call, their matrices are read from instance data in the frame ring
     class SimpleRenderSystem {
     public:
+        struct InstanceData {
+            glm::mat4 modelMatrix{1.0f};
+            glm::mat4 normalMatrix{1.0f};
+
+            static std::vector<VkVertexInputBindingDescription> getBindingDescription();
+            static std::vector<VkVertexInputAttributeDescription> getAttributeDescription();
+        };
+
+        // objects of the last rendered frame
+        struct CullingStats {
+            uint32_t tested;
+            uint32_t culled;
+        };
+
         SimpleRenderSystem(ZeDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
         ~SimpleRenderSystem();
 
         SimpleRenderSystem(const SimpleRenderSystem&) = delete;
         SimpleRenderSystem &operator=(const SimpleRenderSystem&) = delete;
 
+        // objects whose world bounding sphere is outside the camera frustum are not drawn, with a
+        // frameInfo.recorder the visible objects are split in ranges recorded in parallel
         void renderGameObjects(FrameInfo &frameInfo);
 
+        const CullingStats &getCullingStats() const { return cullingStats; }
+
     private:
+        struct DrawItem {
+            ZeModel *model;
+            ZeGameObject *gameObject;
+            glm::mat4 modelMatrix;
+        };
+
         void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
         void createPipeline(VkRenderPass renderPass);
+        // writes the instances of drawItems[begin, end) and records their draws
+        void recordRange(FrameInfo &frameInfo, VkCommandBuffer commandBuffer, const ZeFrameRing::Allocation &instances,
+                         size_t begin, size_t end);
 
         ZeDevice &zeDevice;
 
         std::unique_ptr<ZePipeline> zePipeline;
         VkPipelineLayout  pipelineLayout;
+
+        std::vector<DrawItem> drawItems;
+        std::vector<glm::vec4> boundingSpheres;
+        std::vector<uint8_t> visibility;
+        CullingStats cullingStats{};
     };
 
-}
\ No newline at end of file
+}
@@ -5,21 +5,29 @@
 
 #include "ze_camera.hpp"
 #include "ze_app.hpp"
-#include "ze_buffer.hpp"
+#include "ze_frame_ring.hpp"
 #include "systems/simple_render_system.hpp"
 #include "systems/point_light_system.hpp"
+#include "systems/light_cluster_system.hpp"
 #include "keyboard_movement_controller.hpp"
+#include "ze_cpu_profiler.hpp"
 
+#include <algorithm>
 #include <array>
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <numeric>
+#include <stdexcept>
+#include <string>
 
 namespace ze {
 
     ZeApp::ZeApp() {
         globalPool = ZeDescriptorPool::Builder(zeDevice)
-                .setMaxSets(ZeSwapChain::MAX_FRAMES_IN_FLIGHT)
-                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, ZeSwapChain::MAX_FRAMES_IN_FLIGHT)
+                .setMaxSets(1)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 3)
                 .build();
         loadGameObjects();
     }
@@ -28,31 +36,49 @@ namespace ze {
     }
 
     void ZeApp::run() {
-        std::vector<std::unique_ptr<ZeBuffer>> uboBuffers(ZeSwapChain::MAX_FRAMES_IN_FLIGHT);
-        for(int i = 0; i < uboBuffers.size(); i++) {
-            uboBuffers[i] = std::make_unique<ZeBuffer>(
-                    zeDevice,
-                    sizeof(GlobalUbo),
-                    1,
-                    VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
-            );
-            uboBuffers[i]->map();
+        // the scene doesn't grow once loaded : room for the instances of every object and the
+        // light clusters at their largest, plus the uniforms and the alignments
+        size_t lightCount = 0;
+        for (auto &kv : gameObjects) {
+            if (kv.second.pointLight != nullptr) lightCount++;
         }
-
+        // the light arrays are bound with one fixed range, past the end of the arrays of the frame
+        const VkDeviceSize storageRange = LightClusterSystem::maxFrameStorage(lightCount);
+        ZeFrameRing frameRing{
+            zeDevice,
+            zeRenderer.getFramesInFlight(),
+            std::max<VkDeviceSize>(ZeFrameRing::DEFAULT_FRAME_CAPACITY,
+                                   gameObjects.size() * sizeof(SimpleRenderSystem::InstanceData) +
+                                   storageRange +
+                                   64 * 1024),
+            storageRange};
+
+        // the GlobalUbo and the light clusters of each frame are pushed to the ring, one set for all the frames
         auto globalSetLayout = ZeDescriptorSetLayout::Builder(zeDevice)
-                .addBinding(0,
-                            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                .addBinding(GLOBAL_UBO_BINDING,
+                            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
                             VK_SHADER_STAGE_ALL_GRAPHICS)
+                .addBinding(GLOBAL_LIGHTS_BINDING,
+                            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+                            VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(GLOBAL_LIGHT_CLUSTERS_BINDING,
+                            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+                            VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(GLOBAL_LIGHT_INDICES_BINDING,
+                            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+                            VK_SHADER_STAGE_FRAGMENT_BIT)
                 .build();
 
-        std::vector<VkDescriptorSet> globalDescriptorSets(ZeSwapChain::MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < globalDescriptorSets.size(); i++) {
-            auto bufferInfo = uboBuffers[i]->descriptorInfo();
-            ZeDescriptorWriter(*globalSetLayout, *globalPool)
-                .writeBuffer(0, &bufferInfo)
-                .build(globalDescriptorSets[i]);
-        }
+        VkDescriptorSet globalDescriptorSet;
+        auto uboInfo = frameRing.descriptorInfo(sizeof(GlobalUbo));
+        // a dynamic offset plus VK_WHOLE_SIZE would run past the buffer, the ring is padded for this range
+        auto storageInfo = frameRing.descriptorInfo(storageRange);
+        ZeDescriptorWriter(*globalSetLayout, *globalPool)
+            .writeBuffer(GLOBAL_UBO_BINDING, &uboInfo)
+            .writeBuffer(GLOBAL_LIGHTS_BINDING, &storageInfo)
+            .writeBuffer(GLOBAL_LIGHT_CLUSTERS_BINDING, &storageInfo)
+            .writeBuffer(GLOBAL_LIGHT_INDICES_BINDING, &storageInfo)
+            .build(globalDescriptorSet);
 
         SimpleRenderSystem simpleRenderSystem{
             zeDevice,
@@ -62,18 +88,28 @@ namespace ze {
             zeDevice,
             zeRenderer.getSwapChainRenderPass(),
             globalSetLayout->getDescriptorSetLayout()};
+        LightClusterSystem lightClusterSystem{};
         ZeCamera camera{};
 
-        auto cameraObject = ZeGameObject::createGameObject();
-        cameraObject.transform.translation.z = -3.0f;
-        cameraObject.transform.translation.y = -1.5f;
-        cameraObject.transform.rotation.x = -0.5f;
+        auto cameraObject = ZeGameObject::createGameObject(transformStore);
+        cameraObject.transform.translation().z = -3.0f;
+        cameraObject.transform.translation().y = -1.5f;
+        cameraObject.transform.rotation().x = -0.5f;
         KeyboardMovementController cameraController{};
 
         auto currentTime = std::chrono::high_resolution_clock::now();
 
+        ZeCpuProfiler::setThreadName("main");
         while (!zeWindow.shouldClose()) {
-            glfwPollEvents();
+            ZE_PROFILE_SCOPE("frame");
+            {
+                ZE_PROFILE_SCOPE("poll events");
+                glfwPollEvents();
+            }
+            {
+                ZE_PROFILE_SCOPE("asset loader update");
+                assetLoader.update(gameObjects);
+            }
 
             auto newTime =  std::chrono::high_resolution_clock::now();
             float delta = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
@@ -81,21 +117,33 @@ namespace ze {
 
             //delta = glm::min(delta, MAX_FRAME_TIME);
 
-            cameraController.moveInPlaneXZ(zeWindow.getGLFWwindow(), delta, cameraObject);
-            camera.setViewYXZ(cameraObject.transform.translation, cameraObject.transform.rotation);
+            {
+                ZE_PROFILE_SCOPE("camera update");
+                cameraController.moveInPlaneXZ(zeWindow.getGLFWwindow(), delta, cameraObject);
+                const auto &cameraTransform = cameraObject.transform;
+                camera.setViewYXZ(cameraTransform.translation(), cameraTransform.rotation());
 
-            float aspect = zeRenderer.getAspectRatio();
-            camera.setPerspectiveProjection(glm::radians(50.0f), aspect, 0.1f, 100.0f);
+                float aspect = zeRenderer.getAspectRatio();
+                camera.setPerspectiveProjection(glm::radians(50.0f), aspect, 0.1f, 100.0f);
+            }
 
-            if (auto commandBuffer = zeRenderer.beginFrame()) {
+            VkCommandBuffer commandBuffer;
+            {
+                ZE_PROFILE_SCOPE("begin frame");
+                commandBuffer = zeRenderer.beginFrame();
+            }
+            if (commandBuffer != nullptr) {
                 int frameIndex = zeRenderer.getFrameIndex();
+                frameRing.beginFrame(frameIndex);
                 FrameInfo frameInfo{
                     frameIndex,
                     delta,
                     commandBuffer,
                     camera,
-                    globalDescriptorSets[frameIndex],
-                    gameObjects
+                    globalDescriptorSet,
+                    gameObjects,
+                    zeRenderer.getParallelRecorder(),
+                    &frameRing
                 };
 
                 // update
@@ -103,44 +151,82 @@ namespace ze {
                 ubo.projection = camera.getProjection();
                 ubo.view = camera.getView();
                 ubo.inverseView = camera.getInverseView();
-                pointLightSystem.update(frameInfo, ubo);
-                uboBuffers[frameIndex]->writeToBuffer(&ubo);
-                uboBuffers[frameIndex]->flush();
+                {
+                    ZE_PROFILE_SCOPE("PointLightSystem::update");
+                    pointLightSystem.update(frameInfo);
+                }
+                {
+                    ZE_PROFILE_SCOPE("LightClusterSystem::update");
+                    lightClusterSystem.update(frameInfo, ubo);
+                }
+                {
+                    ZE_PROFILE_SCOPE("transform update");
+                    transformStore.updateMatrices();
+                }
+                {
+                    ZE_PROFILE_SCOPE("ubo write");
+                    frameInfo.globalOffsets[GLOBAL_UBO_BINDING] = frameRing.pushUniform(ubo);
+                }
 
                 // render
-                zeRenderer.beginSwapChainRenderPass(commandBuffer);
-
-                // order here matters
-                simpleRenderSystem.renderGameObjects(frameInfo);
-                pointLightSystem.render(frameInfo);
+                {
+                    ZE_PROFILE_SCOPE("record");
+                    zeRenderer.beginSwapChainRenderPass(commandBuffer);
+
+                    // order here matters
+                    {
+                        ZeGpuProfiler::Scope scope{zeRenderer.getGpuProfiler(), commandBuffer, "SimpleRenderSystem"};
+                        simpleRenderSystem.renderGameObjects(frameInfo);
+                    }
+                    {
+                        ZeGpuProfiler::Scope scope{zeRenderer.getGpuProfiler(), commandBuffer, "PointLightSystem"};
+                        pointLightSystem.render(frameInfo);
+                    }
+
+                    zeRenderer.endSwapChainRenderPass(commandBuffer);
+                }
+                {
+                    ZE_PROFILE_SCOPE("end frame");
+                    zeRenderer.endFrame();
+                }
+            }
+        }
+        zeDevice.waitIdle();
 
-                zeRenderer.endSwapChainRenderPass(commandBuffer);
-                zeRenderer.endFrame();
+        // ZE_CPU_TRACE=path.json dumps the last frames for chrome://tracing
+        if (const char *tracePath = std::getenv("ZE_CPU_TRACE")) {
+            std::ofstream trace{tracePath};
+            if (!trace.is_open()) {
+                throw std::runtime_error(std::string{"failed to open file: "} + tracePath);
+            }
+            ZeCpuProfiler::writeChromeTrace(trace);
+            if (!trace) {
+                throw std::runtime_error(std::string{"failed to write file: "} + tracePath);
             }
         }
-        vkDeviceWaitIdle(zeDevice.device());
     }
 
     void ZeApp::loadGameObjects() {
-        std::shared_ptr<ZeModel> zeModel = ZeModel::createModelFromFile(zeDevice, "models/pumpkin_1.obj");
-        std::shared_ptr<ZeModel> zeModel1 = ZeModel::createModelFromFile(zeDevice, "models/quad.obj");
-
-        auto gameObject1 = ZeGameObject::createGameObject();
-        gameObject1.model = zeModel;
-        gameObject1.transform.translation = { 0.3f, 0.5f, 0.0f };
-        gameObject1.transform.scale = glm::vec3{1.2f };
+        // models are attached by assetLoader.update() once loaded
+        auto zeModel = assetLoader.loadModel("models/pumpkin_1.obj");
+        auto zeModel1 = assetLoader.loadModel("models/quad.obj");
+
+        auto gameObject1 = ZeGameObject::createGameObject(transformStore);
+        assetLoader.bindModel(gameObject1, zeModel);
+        gameObject1.transform.translation() = { 0.3f, 0.5f, 0.0f };
+        gameObject1.transform.scale() = glm::vec3{1.2f };
         gameObjects.emplace(gameObject1.getId(), std::move(gameObject1));
 
-        auto gameObject2 = ZeGameObject::createGameObject();
-        gameObject2.model = zeModel;
-        gameObject2.transform.translation = { -0.3f, 0.5f, 0.0f };
-        gameObject2.transform.scale = glm::vec3{1.2f };
+        auto gameObject2 = ZeGameObject::createGameObject(transformStore);
+        assetLoader.bindModel(gameObject2, zeModel);
+        gameObject2.transform.translation() = { -0.3f, 0.5f, 0.0f };
+        gameObject2.transform.scale() = glm::vec3{1.2f };
         gameObjects.emplace(gameObject2.getId(), std::move(gameObject2));
 
-        auto floor = ZeGameObject::createGameObject();
-        floor.model = zeModel1;
-        floor.transform.translation = { 0.0f, 0.5f, 0.0f };
-        floor.transform.scale = glm::vec3{2.0f };
+        auto floor = ZeGameObject::createGameObject(transformStore);
+        assetLoader.bindModel(floor, zeModel1);
+        floor.transform.translation() = { 0.0f, 0.5f, 0.0f };
+        floor.transform.scale() = glm::vec3{2.0f };
         gameObjects.emplace(floor.getId(), std::move(floor));
 
         std::vector<glm::vec3> lightColors{
@@ -153,14 +239,14 @@ namespace ze {
         };
 
         for (int i = 0; i < lightColors.size(); i++) {
-            auto pointLight = ZeGameObject::makePointLight(0.2f);
+            auto pointLight = ZeGameObject::makePointLight(transformStore, 0.2f);
             pointLight.color = lightColors[i];
             auto rotateLight = glm::rotate(
                     glm::mat4(1.f),
                     (i * glm::two_pi<float>()) / lightColors.size(),
                     {0.0f, -1.0f, 0.0f}
                     );
-            pointLight.transform.translation = glm::vec3(rotateLight * glm::vec4(-1.0f, -0.5f, -1.0f, 1.0f));
+            pointLight.transform.translation() = glm::vec3(rotateLight * glm::vec4(-1.0f, -0.5f, -1.0f, 1.0f));
             gameObjects.emplace(pointLight.getId(), std::move(pointLight));
         }
     }
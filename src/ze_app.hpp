@@ -5,6 +5,7 @@
 #include "ze_game_object.hpp"
 #include "ze_renderer.hpp"
 #include "ze_descriptors.hpp"
+#include "ze_asset_loader.hpp"
 
 #include <memory>
 #include <vector>
@@ -33,6 +34,9 @@ namespace ze {
 
         // note : order of declarations matters (must be destroyed before the ZeDevice)
         std::unique_ptr<ZeDescriptorPool> globalPool{};
+        ZeAssetLoader assetLoader{zeDevice};
+        // must outlive the game objects
+        ZeTransformStore transformStore;
         ZeGameObject::Map gameObjects;
     };
 
@@ -0,0 +1,116 @@
+#include "ze_asset_loader.hpp"
+#include "ze_mesh_cache.hpp"
+#include "ze_cpu_profiler.hpp"
+
+#include <chrono>
+
+namespace ze {
+
+    namespace {
+        // CPU side of a model, either mapped from the mesh cache or parsed from the OBJ
+        struct ParsedModel {
+            std::unique_ptr<ZeMeshCache> cache;
+            ZeModel::Builder builder;
+        };
+    }
+
+    ZeAssetLoader::ZeAssetLoader(ZeDevice &device, uint32_t parseThreadCount)
+            : zeDevice{device},
+              uploader{std::make_unique<ZeUploadBatcher>(device)},
+              parsePool{parseThreadCount} {
+    }
+
+    ZeAssetLoader::~ZeAssetLoader() {
+    }
+
+    ZeAssetLoader::ModelHandle ZeAssetLoader::loadModel(const std::string &filepath) {
+        std::lock_guard<std::mutex> lock{modelsMutex};
+        auto it = models.find(filepath);
+        if (it != models.end()) {
+            return it->second;
+        }
+
+        auto promise = std::make_shared<std::promise<std::shared_ptr<ZeModel>>>();
+        ModelHandle handle = promise->get_future().share();
+        models[filepath] = handle;
+
+        parsePool.submit([this, filepath, promise]() {
+            ZE_PROFILE_SCOPE("parse model");
+            auto parsed = std::make_shared<ParsedModel>();
+            try {
+                parsed->cache = ZeMeshCache::open(filepath);
+                if (parsed->cache == nullptr) {
+                    parsed->builder.loadModel(filepath);
+                    ZeMeshCache::write(filepath, parsed->builder);
+                }
+            } catch (...) {
+                promise->set_exception(std::current_exception());
+                return;
+            }
+
+            queuedUploads++;
+            transferPool.submit([this, parsed, promise]() {
+                ZE_PROFILE_SCOPE("upload model");
+                try {
+                    std::shared_ptr<ZeModel> model;
+                    if (parsed->cache != nullptr) {
+                        model = std::make_shared<ZeModel>(
+                                zeDevice,
+                                parsed->cache->getVertices(), parsed->cache->getVertexCount(),
+                                parsed->cache->getIndices(), parsed->cache->getIndexCount(),
+                                parsed->cache->getBounds(),
+                                uploader.get());
+                    } else {
+                        model = std::make_shared<ZeModel>(zeDevice, parsed->builder, uploader.get());
+                    }
+                    stagedModels.emplace_back(std::move(model), promise);
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+                // the last queued upload submits the whole batch
+                if (--queuedUploads == 0) {
+                    flushStagedModels();
+                }
+            });
+        });
+        return handle;
+    }
+
+    void ZeAssetLoader::flushStagedModels() {
+        try {
+            uploader->flush();
+        } catch (...) {
+            for (auto &staged : stagedModels) {
+                staged.second->set_exception(std::current_exception());
+            }
+            stagedModels.clear();
+            return;
+        }
+        for (auto &staged : stagedModels) {
+            staged.second->set_value(std::move(staged.first));
+        }
+        stagedModels.clear();
+    }
+
+    void ZeAssetLoader::bindModel(ZeGameObject &gameObject, ModelHandle handle) {
+        pendingBindings.emplace_back(gameObject.getId(), std::move(handle));
+    }
+
+    void ZeAssetLoader::update(ZeGameObject::Map &gameObjects) {
+        for (size_t i = 0; i < pendingBindings.size();) {
+            auto &binding = pendingBindings[i];
+            if (binding.second.wait_for(std::chrono::seconds{0}) != std::future_status::ready) {
+                i++;
+                continue;
+            }
+            auto model = binding.second.get();
+            auto it = gameObjects.find(binding.first);
+            if (it != gameObjects.end()) {
+                it->second.model = std::move(model);
+            }
+            pendingBindings[i] = std::move(pendingBindings.back());
+            pendingBindings.pop_back();
+        }
+    }
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ze_device.hpp"
+#include "ze_game_object.hpp"
+#include "ze_model.hpp"
+#include "ze_thread_pool.hpp"
+#include "ze_upload_batcher.hpp"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ze {
+
+    // Loads models in the background : files are parsed on a pool of workers and uploaded on a
+    // dedicated transfer thread, so the render loop never waits for an asset. Uploads queued
+    // together are batched into a single submit.
+    class ZeAssetLoader {
+    public:
+        using ModelHandle = std::shared_future<std::shared_ptr<ZeModel>>;
+
+        explicit ZeAssetLoader(ZeDevice &device, uint32_t parseThreadCount = std::thread::hardware_concurrency());
+        ~ZeAssetLoader();
+
+        ZeAssetLoader(const ZeAssetLoader&) = delete;
+        ZeAssetLoader &operator=(const ZeAssetLoader&) = delete;
+
+        // requesting the same file twice returns the same handle
+        ModelHandle loadModel(const std::string &filepath);
+
+        // gameObject.model is set by update() once the model is resident, until then the
+        // object has no model and is not drawn
+        void bindModel(ZeGameObject &gameObject, ModelHandle handle);
+
+        // call once per frame from the render thread, rethrows loading errors
+        void update(ZeGameObject::Map &gameObjects);
+
+        bool hasPendingBindings() const { return !pendingBindings.empty(); }
+
+    private:
+        using ModelPromise = std::shared_ptr<std::promise<std::shared_ptr<ZeModel>>>;
+
+        // transfer thread only
+        void flushStagedModels();
+
+        ZeDevice &zeDevice;
+
+        // declaration order matters : parse tasks enqueue uploads, so the parse pool is
+        // destroyed (and drained) first, then the transfer thread, then its uploader
+        std::unique_ptr<ZeUploadBatcher> uploader;
+        std::vector<std::pair<std::shared_ptr<ZeModel>, ModelPromise>> stagedModels;
+        std::atomic<uint32_t> queuedUploads{0};
+        ZeThreadPool transferPool{1};
+        ZeThreadPool parsePool;
+
+        std::mutex modelsMutex;
+        std::unordered_map<std::string, ModelHandle> models;
+        std::vector<std::pair<ZeGameObject::id_t, ModelHandle>> pendingBindings;
+    };
+
+}
@@ -0,0 +1,418 @@
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "ze_benchmark.hpp"
+#include "ze_camera.hpp"
+#include "ze_frame_ring.hpp"
+#include "ze_cpu_profiler.hpp"
+#include "ze_utils.hpp"
+#include "systems/simple_render_system.hpp"
+#include "systems/point_light_system.hpp"
+#include "systems/light_cluster_system.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace ze {
+
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        double elapsedMs(Clock::time_point start, Clock::time_point end) {
+            return std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        // nearest rank on a sorted copy
+        void writeStats(std::ostream &out, const char *name, const std::vector<double> &values) {
+            out << "    \"" << name << "\": ";
+            if (values.empty()) {
+                out << "null";
+                return;
+            }
+            std::vector<double> sorted{values};
+            std::sort(sorted.begin(), sorted.end());
+            auto percentile = [&sorted](double p) {
+                auto rank = static_cast<size_t>(std::ceil(p * static_cast<double>(sorted.size())));
+                return sorted[std::max<size_t>(rank, 1) - 1];
+            };
+            double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / static_cast<double>(sorted.size());
+            out << "{ \"mean\": " << mean
+                << ", \"min\": " << sorted.front()
+                << ", \"p50\": " << percentile(0.50)
+                << ", \"p90\": " << percentile(0.90)
+                << ", \"p99\": " << percentile(0.99)
+                << ", \"max\": " << sorted.back() << " }";
+        }
+    }
+
+    ZeBenchmark::ZeBenchmark(const Config &config):
+            config{config},
+            zeRenderer{zeDevice, {config.width, config.height}, config.framesInFlight} {
+        globalPool = ZeDescriptorPool::Builder(zeDevice)
+                .setMaxSets(1)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
+                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 3)
+                .build();
+        zeRenderer.setParallelRecording(config.recordThreadCount);
+        createQueryPool();
+        loadGameObjects();
+        waitForAssets();
+    }
+
+    ZeBenchmark::~ZeBenchmark() {
+        if (queryPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(zeDevice.device(), queryPool, nullptr);
+        }
+    }
+
+    void ZeBenchmark::createQueryPool() {
+        pendingGpuSamples.assign(zeRenderer.getFramesInFlight(), -1);
+        if (!zeDevice.properties.limits.timestampComputeAndGraphics) {
+            return;
+        }
+        VkQueryPoolCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        createInfo.queryCount = 2 * zeRenderer.getFramesInFlight();
+        if (vkCreateQueryPool(zeDevice.device(), &createInfo, nullptr, &queryPool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create timestamp query pool");
+        }
+    }
+
+    void ZeBenchmark::readGpuSample(int frameIndex) {
+        int sample = pendingGpuSamples[frameIndex];
+        if (sample < 0) {
+            return;
+        }
+        uint64_t timestamps[2];
+        if (vkGetQueryPoolResults(zeDevice.device(), queryPool,
+                                  static_cast<uint32_t>(frameIndex * 2), 2,
+                                  sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                  VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+            throw std::runtime_error("failed to read timestamp queries");
+        }
+        double ticks = static_cast<double>(timestamps[1] - timestamps[0]);
+        samples.gpu[sample] = ticks * zeDevice.properties.limits.timestampPeriod / 1.0e6;
+        pendingGpuSamples[frameIndex] = -1;
+    }
+
+    void ZeBenchmark::run() {
+        // room for the instances of every object and the light clusters at their largest, plus the
+        // uniforms and the alignments
+        // the light arrays are bound with one fixed range, past the end of the arrays of the frame
+        const VkDeviceSize storageRange = LightClusterSystem::maxFrameStorage(config.lightCount);
+        ZeFrameRing frameRing{
+            zeDevice,
+            zeRenderer.getFramesInFlight(),
+            std::max<VkDeviceSize>(ZeFrameRing::DEFAULT_FRAME_CAPACITY,
+                                   gameObjects.size() * sizeof(SimpleRenderSystem::InstanceData) +
+                                   storageRange +
+                                   64 * 1024),
+            storageRange};
+
+        // the GlobalUbo and the light clusters of each frame are pushed to the ring, one set for all the frames
+        auto globalSetLayout = ZeDescriptorSetLayout::Builder(zeDevice)
+                .addBinding(GLOBAL_UBO_BINDING,
+                            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                            VK_SHADER_STAGE_ALL_GRAPHICS)
+                .addBinding(GLOBAL_LIGHTS_BINDING,
+                            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+                            VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(GLOBAL_LIGHT_CLUSTERS_BINDING,
+                            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+                            VK_SHADER_STAGE_FRAGMENT_BIT)
+                .addBinding(GLOBAL_LIGHT_INDICES_BINDING,
+                            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+                            VK_SHADER_STAGE_FRAGMENT_BIT)
+                .build();
+
+        VkDescriptorSet globalDescriptorSet;
+        auto uboInfo = frameRing.descriptorInfo(sizeof(GlobalUbo));
+        // a dynamic offset plus VK_WHOLE_SIZE would run past the buffer, the ring is padded for this range
+        auto storageInfo = frameRing.descriptorInfo(storageRange);
+        ZeDescriptorWriter(*globalSetLayout, *globalPool)
+            .writeBuffer(GLOBAL_UBO_BINDING, &uboInfo)
+            .writeBuffer(GLOBAL_LIGHTS_BINDING, &storageInfo)
+            .writeBuffer(GLOBAL_LIGHT_CLUSTERS_BINDING, &storageInfo)
+            .writeBuffer(GLOBAL_LIGHT_INDICES_BINDING, &storageInfo)
+            .build(globalDescriptorSet);
+
+        SimpleRenderSystem simpleRenderSystem{
+            zeDevice,
+            zeRenderer.getSwapChainRenderPass(),
+            globalSetLayout->getDescriptorSetLayout()};
+        PointLightSystem pointLightSystem {
+            zeDevice,
+            zeRenderer.getSwapChainRenderPass(),
+            globalSetLayout->getDescriptorSetLayout()};
+        LightClusterSystem lightClusterSystem{};
+        ZeCamera camera{};
+
+        samples = Samples{};
+        samples.cpuRecord.reserve(config.frameCount);
+        samples.submit.reserve(config.frameCount);
+        if (queryPool != VK_NULL_HANDLE) {
+            samples.gpu.resize(config.frameCount);
+        }
+
+        ZeCpuProfiler::setThreadName("main");
+        const uint32_t totalFrames = config.warmupFrameCount + config.frameCount;
+        for (uint32_t frame = 0; frame < totalFrames; frame++) {
+            ZE_PROFILE_SCOPE("frame");
+            // the time only depends on the frame number, never on the clock
+            const float time = static_cast<float>(frame) * config.timestep;
+            const auto key = sampleCameraPath(time);
+            camera.setViewYXZ(key.translation, key.rotation);
+            camera.setPerspectiveProjection(glm::radians(50.0f), zeRenderer.getAspectRatio(), 0.1f, 100.0f);
+
+            // beginFrame() waits for the frame in flight, this is not recording time
+            auto commandBuffer = zeRenderer.beginFrame();
+            const auto recordStart = Clock::now();
+            int frameIndex = zeRenderer.getFrameIndex();
+            frameRing.beginFrame(frameIndex);
+            if (queryPool != VK_NULL_HANDLE) {
+                // the previous use of the frame slot is complete, its timestamps are available
+                readGpuSample(frameIndex);
+                vkCmdResetQueryPool(commandBuffer, queryPool, static_cast<uint32_t>(frameIndex * 2), 2);
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                    queryPool, static_cast<uint32_t>(frameIndex * 2));
+            }
+
+            FrameInfo frameInfo{
+                frameIndex,
+                config.timestep,
+                commandBuffer,
+                camera,
+                globalDescriptorSet,
+                gameObjects,
+                zeRenderer.getParallelRecorder(),
+                &frameRing
+            };
+
+            // update
+            GlobalUbo ubo{};
+            ubo.projection = camera.getProjection();
+            ubo.view = camera.getView();
+            ubo.inverseView = camera.getInverseView();
+            pointLightSystem.update(frameInfo);
+            lightClusterSystem.update(frameInfo, ubo);
+            transformStore.updateMatrices();
+            frameInfo.globalOffsets[GLOBAL_UBO_BINDING] = frameRing.pushUniform(ubo);
+
+            // render
+            zeRenderer.beginSwapChainRenderPass(commandBuffer);
+            {
+                ZeGpuProfiler::Scope scope{zeRenderer.getGpuProfiler(), commandBuffer, "SimpleRenderSystem"};
+                simpleRenderSystem.renderGameObjects(frameInfo);
+            }
+            {
+                ZeGpuProfiler::Scope scope{zeRenderer.getGpuProfiler(), commandBuffer, "PointLightSystem"};
+                pointLightSystem.render(frameInfo);
+            }
+            zeRenderer.endSwapChainRenderPass(commandBuffer);
+
+            if (queryPool != VK_NULL_HANDLE) {
+                vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                    queryPool, static_cast<uint32_t>(frameIndex * 2 + 1));
+            }
+            const auto submitStart = Clock::now();
+            zeRenderer.endFrame();
+            const auto submitEnd = Clock::now();
+
+            if (frame >= config.warmupFrameCount) {
+                samples.cpuRecord.push_back(elapsedMs(recordStart, submitStart));
+                samples.submit.push_back(elapsedMs(submitStart, submitEnd));
+                const auto &clusterStats = lightClusterSystem.getStats();
+                samples.maxClusterLights = std::max(samples.maxClusterLights, clusterStats.maxClusterLights);
+                samples.averageClusterLights += clusterStats.averageClusterLights / static_cast<double>(config.frameCount);
+                if (queryPool != VK_NULL_HANDLE) {
+                    pendingGpuSamples[frameIndex] = static_cast<int>(frame - config.warmupFrameCount);
+                }
+            }
+        }
+        zeDevice.waitIdle();
+        if (queryPool != VK_NULL_HANDLE) {
+            for (uint32_t i = 0; i < zeRenderer.getFramesInFlight(); i++) {
+                readGpuSample(i);
+            }
+        }
+    }
+
+    void ZeBenchmark::writeJson(std::ostream &out) const {
+        out << "{\n";
+        out << "  \"device\": " << jsonString(zeDevice.properties.deviceName) << ",\n";
+        out << "  \"config\": {\n"
+            << "    \"objects\": " << config.objectCount << ",\n"
+            << "    \"lights\": " << config.lightCount << ",\n"
+            << "    \"frames\": " << config.frameCount << ",\n"
+            << "    \"warmupFrames\": " << config.warmupFrameCount << ",\n"
+            << "    \"width\": " << config.width << ",\n"
+            << "    \"height\": " << config.height << ",\n"
+            << "    \"timestep\": " << config.timestep << ",\n"
+            << "    \"recordThreads\": " << config.recordThreadCount << ",\n"
+            << "    \"framesInFlight\": " << config.framesInFlight << ",\n"
+            << "    \"model\": " << jsonString(config.modelPath) << ",\n"
+            << "    \"cameraPath\": " << (config.cameraPath.empty() ? "null" : jsonString(config.cameraPath)) << "\n"
+            << "  },\n";
+        // cold without a valid cache file, run twice to compare
+        const auto pipelineCache = zeDevice.pipelineCacheStats();
+        out << "  \"pipelineCache\": {\n"
+            << "    \"warm\": " << (pipelineCache.warm ? "true" : "false") << ",\n"
+            << "    \"loadedBytes\": " << pipelineCache.loadedSize << ",\n"
+            << "    \"pipelines\": " << pipelineCache.pipelineCount << ",\n"
+            << "    \"creationMilliseconds\": " << pipelineCache.creationMilliseconds << ",\n"
+            << "    \"creationWallMilliseconds\": " << pipelineCache.creationWallMilliseconds << "\n"
+            << "  },\n";
+        // lights shaded per fragment, against every light for a loop over all of them
+        out << "  \"lightClusters\": {\n"
+            << "    \"maxLights\": " << samples.maxClusterLights << ",\n"
+            << "    \"averageLights\": " << samples.averageClusterLights << ",\n"
+            << "    \"unclusteredLights\": " << config.lightCount << "\n"
+            << "  },\n";
+        out << "  \"milliseconds\": {\n";
+        writeStats(out, "cpuRecord", samples.cpuRecord);
+        out << ",\n";
+        writeStats(out, "submit", samples.submit);
+        out << ",\n";
+        writeStats(out, "gpu", samples.gpu);
+        out << "\n  },\n";
+        // rolling averages of the last frames, per profiler scope
+        out << "  \"gpuScopesMilliseconds\": {";
+        const auto scopes = zeRenderer.getGpuProfiler().getStats();
+        for (size_t i = 0; i < scopes.size(); i++) {
+            out << (i == 0 ? "\n" : ",\n")
+                << "    " << jsonString(scopes[i].name) << ": " << scopes[i].averageMs;
+        }
+        out << (scopes.empty() ? "}\n" : "\n  }\n");
+        out << "}\n";
+    }
+
+    std::vector<ZeBenchmark::CameraKey> ZeBenchmark::loadCameraPath(const std::string &filepath) {
+        std::ifstream file{filepath};
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file: " + filepath);
+        }
+
+        std::vector<CameraKey> keys;
+        std::string line;
+        while (std::getline(file, line)) {
+            auto first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') continue;
+            std::istringstream values{line};
+            CameraKey key{};
+            if (!(values >> key.time
+                         >> key.translation.x >> key.translation.y >> key.translation.z
+                         >> key.rotation.x >> key.rotation.y >> key.rotation.z)) {
+                throw std::runtime_error("invalid camera path key in " + filepath + " : " + line);
+            }
+            keys.push_back(key);
+        }
+        if (keys.empty()) {
+            throw std::runtime_error("empty camera path: " + filepath);
+        }
+        std::stable_sort(keys.begin(), keys.end(), [](const CameraKey &a, const CameraKey &b) {
+            return a.time < b.time;
+        });
+        return keys;
+    }
+
+    std::vector<ZeBenchmark::CameraKey> ZeBenchmark::orbitCameraPath(float radius) {
+        // one turn in 8 seconds, slightly above the objects and looking at the center
+        constexpr int KEY_COUNT = 16;
+        constexpr float DURATION = 8.0f;
+        std::vector<CameraKey> keys;
+        for (int i = 0; i <= KEY_COUNT; i++) {
+            float angle = glm::two_pi<float>() * static_cast<float>(i) / KEY_COUNT;
+            keys.push_back({
+                DURATION * static_cast<float>(i) / KEY_COUNT,
+                {-radius * glm::sin(angle), -1.5f, -radius * glm::cos(angle)},
+                {-0.3f, angle, 0.0f}});
+        }
+        return keys;
+    }
+
+    ZeBenchmark::CameraKey ZeBenchmark::sampleCameraPath(float time) const {
+        // loops over the path
+        const float duration = cameraPath.back().time;
+        if (duration > 0.0f) {
+            time = std::fmod(time, duration);
+        }
+        auto next = std::upper_bound(cameraPath.begin(), cameraPath.end(), time,
+                                     [](float t, const CameraKey &key) { return t < key.time; });
+        if (next == cameraPath.begin()) return cameraPath.front();
+        if (next == cameraPath.end()) return cameraPath.back();
+        const auto &previous = *(next - 1);
+        float span = next->time - previous.time;
+        float t = span > 0.0f ? (time - previous.time) / span : 0.0f;
+        return {
+            time,
+            glm::mix(previous.translation, next->translation, t),
+            glm::mix(previous.rotation, next->rotation, t)};
+    }
+
+    void ZeBenchmark::waitForAssets() {
+        while (assetLoader.hasPendingBindings()) {
+            assetLoader.update(gameObjects);
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+    }
+
+    void ZeBenchmark::loadGameObjects() {
+        // models are attached by waitForAssets() before the first frame
+        auto zeModel = assetLoader.loadModel(config.modelPath);
+        auto floorModel = assetLoader.loadModel("models/quad.obj");
+
+        // objects on a square grid centered on the origin
+        constexpr float SPACING = 0.6f;
+        const auto side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(config.objectCount))));
+        const float extent = static_cast<float>(side) * SPACING;
+        for (uint32_t i = 0; i < config.objectCount; i++) {
+            auto gameObject = ZeGameObject::createGameObject(transformStore);
+            assetLoader.bindModel(gameObject, zeModel);
+            gameObject.transform.translation() = {
+                (static_cast<float>(i % side) + 0.5f) * SPACING - extent * 0.5f,
+                0.5f,
+                (static_cast<float>(i / side) + 0.5f) * SPACING - extent * 0.5f};
+            gameObject.transform.rotation().y = static_cast<float>(i) * 0.7f;
+            gameObject.transform.scale() = glm::vec3{0.5f};
+            gameObjects.emplace(gameObject.getId(), std::move(gameObject));
+        }
+
+        auto floor = ZeGameObject::createGameObject(transformStore);
+        assetLoader.bindModel(floor, floorModel);
+        floor.transform.translation() = {0.0f, 0.5f, 0.0f};
+        floor.transform.scale() = glm::vec3{extent * 0.5f + 1.0f};
+        gameObjects.emplace(floor.getId(), std::move(floor));
+
+        // lights on a grid above the objects, with the intensity and so the range of the application
+        // lights : more lights are packed closer and each cluster sees more of them
+        const uint32_t lightCount = config.lightCount;
+        const auto lightSide = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(lightCount))));
+        const float lightSpacing = extent / static_cast<float>(std::max(lightSide, 1u));
+        for (uint32_t i = 0; i < lightCount; i++) {
+            auto pointLight = ZeGameObject::makePointLight(transformStore, 0.2f);
+            float hue = static_cast<float>(i) / static_cast<float>(lightCount);
+            pointLight.color = glm::clamp(
+                    glm::abs(glm::fract(glm::vec3{hue} + glm::vec3{0.0f, 2.0f / 3.0f, 1.0f / 3.0f}) * 6.0f - 3.0f) - 1.0f,
+                    0.1f, 1.0f);
+            pointLight.transform.translation() = {
+                (static_cast<float>(i % lightSide) + 0.5f) * lightSpacing - extent * 0.5f,
+                -0.5f,
+                (static_cast<float>(i / lightSide) + 0.5f) * lightSpacing - extent * 0.5f};
+            gameObjects.emplace(pointLight.getId(), std::move(pointLight));
+        }
+
+        cameraPath = config.cameraPath.empty() ?
+                orbitCameraPath(extent * 0.75f + 3.0f) :
+                loadCameraPath(config.cameraPath);
+    }
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ze_device.hpp"
+#include "ze_game_object.hpp"
+#include "ze_renderer.hpp"
+#include "ze_descriptors.hpp"
+#include "ze_asset_loader.hpp"
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace ze {
+
+    // Renders a generated scene headless along a scripted camera path with a fixed timestep, so
+    // frame times are comparable between runs and commits.
+    class ZeBenchmark {
+    public:
+        struct Config {
+            uint32_t objectCount = 100;
+            uint32_t lightCount = 6;
+            uint32_t frameCount = 1000;
+            // frames rendered before the measures start
+            uint32_t warmupFrameCount = 30;
+            uint32_t width = 800;
+            uint32_t height = 600;
+            float timestep = 1.0f / 60.0f;
+            // workers recording secondary command buffers, 0 records inline
+            uint32_t recordThreadCount = 0;
+            uint32_t framesInFlight = ZeFrameScheduler::DEFAULT_FRAMES_IN_FLIGHT;
+            std::string modelPath = "models/pumpkin_1.obj";
+            // empty for the built-in orbit, see loadCameraPath()
+            std::string cameraPath;
+        };
+
+        struct CameraKey {
+            float time;
+            glm::vec3 translation;
+            glm::vec3 rotation;
+        };
+
+        // milliseconds, one sample per measured frame
+        struct Samples {
+            std::vector<double> cpuRecord;
+            std::vector<double> submit;
+            std::vector<double> gpu;
+            // lights shaded per fragment at most, and on average over the lit clusters
+            uint32_t maxClusterLights = 0;
+            double averageClusterLights = 0.0;
+        };
+
+        explicit ZeBenchmark(const Config &config);
+        ~ZeBenchmark();
+
+        ZeBenchmark(const ZeBenchmark&) = delete;
+        ZeBenchmark &operator=(const ZeBenchmark&) = delete;
+
+        // renders the warmup frames then the measured ones
+        void run();
+        void writeJson(std::ostream &out) const;
+
+        // one key per line : time tx ty tz rx ry rz, lines starting with # are ignored,
+        // keys are sorted by time and the camera is interpolated linearly between them
+        static std::vector<CameraKey> loadCameraPath(const std::string &filepath);
+
+    private:
+        void loadGameObjects();
+        void waitForAssets();
+        void createQueryPool();
+        void readGpuSample(int frameIndex);
+        CameraKey sampleCameraPath(float time) const;
+        static std::vector<CameraKey> orbitCameraPath(float radius);
+
+        Config config;
+        std::vector<CameraKey> cameraPath;
+        Samples samples;
+
+        ZeDevice zeDevice{};
+        ZeRenderer zeRenderer;
+
+        // note : order of declarations matters (must be destroyed before the ZeDevice)
+        std::unique_ptr<ZeDescriptorPool> globalPool{};
+        ZeAssetLoader assetLoader{zeDevice};
+        // two timestamps per frame in flight, VK_NULL_HANDLE when the queue has no timestamps
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        // per frame in flight, index in samples.gpu of the frame whose timestamps are pending, -1 for none
+        std::vector<int> pendingGpuSamples;
+        // must outlive the game objects
+        ZeTransformStore transformStore;
+        ZeGameObject::Map gameObjects;
+    };
+
+}
@@ -6,6 +6,7 @@
  */
 
 #include "ze_buffer.hpp"
+#include "ze_upload_batcher.hpp"
 
 // std
 #include <cassert>
@@ -44,12 +45,17 @@ namespace ze {
 
     ZeBuffer::~ZeBuffer() {
         unmap();
-        vkDestroyBuffer(zeDevice.device(), buffer, nullptr);
-        vkFreeMemory(zeDevice.device(), memory, nullptr);
+        // the frames in flight may still read the buffer
+        zeDevice.destroyDeferred([&device = zeDevice, buffer = buffer, memory = memory]() {
+            vkDestroyBuffer(device.device(), buffer, nullptr);
+            device.allocator().free(memory);
+        });
     }
 
 /**
  * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
+ * Host visible memory blocks are persistently mapped by the allocator, this only exposes the range
+ * after checking it lies in the buffer.
  *
  * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
  * buffer range.
@@ -58,20 +64,24 @@ namespace ze {
  * @return VkResult of the buffer mapping call
  */
     VkResult ZeBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(zeDevice.device(), memory, offset, size, 0, &mapped);
+        assert(buffer && memory.memory && "Called map on buffer before create");
+        if (memory.mapped == nullptr) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        if (offset > bufferSize || (size != VK_WHOLE_SIZE && size > bufferSize - offset)) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        mapped = static_cast<char *>(memory.mapped) + offset;
+        return VK_SUCCESS;
     }
 
 /**
  * Unmap a mapped memory range
  *
- * @note Does not return a result as vkUnmapMemory can't fail
+ * @note The memory block stays mapped until it is released by the allocator
  */
     void ZeBuffer::unmap() {
-        if (mapped) {
-            vkUnmapMemory(zeDevice.device(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
     }
 
 /**
@@ -95,6 +105,22 @@ namespace ze {
         }
     }
 
+/**
+ * Queues a copy of the specified data into the buffer through a staging upload batcher. The
+ * buffer must have been created with VK_BUFFER_USAGE_TRANSFER_DST_BIT
+ *
+ * @param uploader The batcher recording the copy, the data is in the buffer once it is flushed
+ * @param data Pointer to the data to copy, can be released on return
+ * @param size (Optional) Size of the data to copy. Pass VK_WHOLE_SIZE to fill the complete buffer
+ * range.
+ * @param offset (Optional) Byte offset from beginning of the buffer
+ *
+ */
+    void ZeBuffer::upload(ZeUploadBatcher &uploader, const void *data, VkDeviceSize size, VkDeviceSize offset) {
+        assert((usageFlags & VK_BUFFER_USAGE_TRANSFER_DST_BIT) && "Cannot upload to a buffer without transfer dst usage");
+        uploader.upload(buffer, data, size == VK_WHOLE_SIZE ? bufferSize - offset : size, offset);
+    }
+
 /**
  * Flush a memory range of the buffer to make it visible to the device
  *
@@ -107,12 +133,7 @@ namespace ze {
  * @return VkResult of the flush call
  */
     VkResult ZeBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkFlushMappedMemoryRanges(zeDevice.device(), 1, &mappedRange);
+        return zeDevice.allocator().flush(memory, size, offset);
     }
 
 /**
@@ -127,12 +148,7 @@ namespace ze {
  * @return VkResult of the invalidate call
  */
     VkResult ZeBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(zeDevice.device(), 1, &mappedRange);
+        return zeDevice.allocator().invalidate(memory, size, offset);
     }
 
 /**
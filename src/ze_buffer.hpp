@@ -4,6 +4,8 @@
 
 namespace ze {
 
+    class ZeUploadBatcher;
+
     class ZeBuffer {
     public:
         ZeBuffer(
@@ -26,6 +28,8 @@ namespace ze {
         VkDescriptorBufferInfo descriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
         VkResult invalidate(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 
+        void upload(ZeUploadBatcher &uploader, const void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
         void writeToIndex(void* data, int index);
         VkResult flushIndex(int index);
         VkDescriptorBufferInfo descriptorInfoForIndex(int index);
@@ -40,13 +44,15 @@ namespace ze {
         VkMemoryPropertyFlags getMemoryPropertyFlags() const { return memoryPropertyFlags; }
         VkDeviceSize getBufferSize() const { return bufferSize; }
 
-    private:
+        // instanceSize rounded up to minOffsetAlignment, a power of two
         static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
 
+    private:
+
         ZeDevice& zeDevice;
         void* mapped = nullptr;
         VkBuffer buffer = VK_NULL_HANDLE;
-        VkDeviceMemory memory = VK_NULL_HANDLE;
+        ZeAllocation memory{};
 
         VkDeviceSize bufferSize;
         uint32_t instanceCount;
@@ -4,6 +4,8 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 
+#include "ze_frustum.hpp"
+
 namespace ze {
     class ZeCamera {
     public:
@@ -21,6 +23,8 @@ namespace ze {
         const glm::mat4& getView() const { return viewMatrix; }
         const glm::mat4& getInverseView() const { return inverseViewMatrix; }
         const glm::vec3 getPositin() const { return glm::vec3(inverseViewMatrix[3]); }
+        // world space frustum of the current projection and view
+        ZeFrustum getFrustum() const { return ZeFrustum{projectionMatrix * viewMatrix}; }
 
     private:
         glm::mat4 projectionMatrix{1.0f};
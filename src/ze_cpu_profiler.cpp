@@ -0,0 +1,78 @@
+#include "ze_cpu_profiler.hpp"
+#include "ze_utils.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace ze {
+
+    std::vector<std::unique_ptr<ZeCpuProfiler::ThreadBuffer>> &ZeCpuProfiler::threadBuffers() {
+        static std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+        return buffers;
+    }
+
+    std::mutex &ZeCpuProfiler::threadBuffersMutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    uint64_t ZeCpuProfiler::now() {
+        using Clock = std::chrono::steady_clock;
+        static const Clock::time_point origin = Clock::now();
+        return static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - origin).count());
+    }
+
+    ZeCpuProfiler::ThreadBuffer &ZeCpuProfiler::threadBuffer() {
+        thread_local ThreadBuffer *buffer = nullptr;
+        if (buffer == nullptr) {
+            auto created = std::make_unique<ThreadBuffer>();
+            created->events = std::make_unique<Event[]>(EVENTS_PER_THREAD);
+            created->threadName = nullptr;
+            std::lock_guard<std::mutex> lock{threadBuffersMutex()};
+            created->threadId = static_cast<uint32_t>(threadBuffers().size());
+            buffer = created.get();
+            threadBuffers().push_back(std::move(created));
+        }
+        return *buffer;
+    }
+
+    void ZeCpuProfiler::record(const char *name, uint64_t begin, uint64_t end) {
+        auto &buffer = threadBuffer();
+        // single writer per buffer, the release makes the event visible with the count
+        uint64_t count = buffer.count.load(std::memory_order_relaxed);
+        buffer.events[count % EVENTS_PER_THREAD] = {name, begin, end};
+        buffer.count.store(count + 1, std::memory_order_release);
+    }
+
+    void ZeCpuProfiler::setThreadName(const char *name) {
+        threadBuffer().threadName = name;
+    }
+
+    void ZeCpuProfiler::writeChromeTrace(std::ostream &out) {
+        std::lock_guard<std::mutex> lock{threadBuffersMutex()};
+        out << "{\"traceEvents\":[\n";
+        bool first = true;
+        for (const auto &buffer : threadBuffers()) {
+            if (buffer->threadName != nullptr) {
+                out << (first ? "" : ",\n")
+                    << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->threadId
+                    << ",\"args\":{\"name\":" << jsonString(buffer->threadName) << "}}";
+                first = false;
+            }
+            uint64_t count = buffer->count.load(std::memory_order_acquire);
+            uint64_t start = count > EVENTS_PER_THREAD ? count - EVENTS_PER_THREAD : 0;
+            for (uint64_t i = start; i < count; i++) {
+                const auto &event = buffer->events[i % EVENTS_PER_THREAD];
+                // timestamps in microseconds
+                out << (first ? "" : ",\n")
+                    << "{\"name\":" << jsonString(event.name) << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->threadId
+                    << ",\"ts\":" << static_cast<double>(event.begin) / 1.0e3
+                    << ",\"dur\":" << static_cast<double>(event.end - event.begin) / 1.0e3 << "}";
+                first = false;
+            }
+        }
+        out << "\n]}\n";
+    }
+
+}
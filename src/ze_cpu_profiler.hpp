@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Instrument a scope with ZE_PROFILE_SCOPE("name"), name must be a string literal. Defining
+// ZE_NO_PROFILE (ZE_PROFILE=OFF in CMake) strips the markers entirely.
+#ifdef ZE_NO_PROFILE
+#define ZE_PROFILE_SCOPE(name)
+#else
+#define ZE_PROFILE_CONCAT_(a, b) a##b
+#define ZE_PROFILE_CONCAT(a, b) ZE_PROFILE_CONCAT_(a, b)
+#define ZE_PROFILE_SCOPE(name) ::ze::ZeCpuProfiler::Scope ZE_PROFILE_CONCAT(zeProfileScope, __LINE__){name}
+#endif
+
+namespace ze {
+
+    // CPU scopes of every thread, recorded in a per thread ring buffer : the buffer is allocated
+    // the first time a thread records, after that a scope costs two clock reads and a store. The
+    // oldest events are overwritten once a buffer is full.
+    class ZeCpuProfiler {
+    public:
+        static constexpr uint32_t EVENTS_PER_THREAD = 1 << 16;
+
+        class Scope {
+        public:
+            explicit Scope(const char *name): name{name}, begin{now()} {}
+            ~Scope() { record(name, begin, now()); }
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            const char *name;
+            uint64_t begin;
+        };
+
+        // nanoseconds since the first call
+        static uint64_t now();
+        static void record(const char *name, uint64_t begin, uint64_t end);
+
+        // shown as the thread name in the trace, name must be a string literal
+        static void setThreadName(const char *name);
+
+        // chrome://tracing JSON of the events still in the buffers, call it while no thread records
+        static void writeChromeTrace(std::ostream &out);
+
+    private:
+        struct Event {
+            const char *name;
+            uint64_t begin;
+            uint64_t end;
+        };
+
+        struct ThreadBuffer {
+            uint32_t threadId;
+            const char *threadName;
+            std::unique_ptr<Event[]> events;
+            // total recorded, the ring index is count % EVENTS_PER_THREAD
+            std::atomic<uint64_t> count{0};
+        };
+
+        static ThreadBuffer &threadBuffer();
+        // buffers outlive their threads, the events of finished workers are still exported
+        static std::vector<std::unique_ptr<ThreadBuffer>> &threadBuffers();
+        static std::mutex &threadBuffersMutex();
+    };
+
+}
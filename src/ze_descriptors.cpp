@@ -99,7 +99,10 @@ namespace ze {
     }
 
     ZeDescriptorPool::~ZeDescriptorPool() {
-        vkDestroyDescriptorPool(zeDevice.device(), descriptorPool, nullptr);
+        // the frames in flight may still bind its sets
+        zeDevice.destroyDeferred([&device = zeDevice, descriptorPool = descriptorPool]() {
+            vkDestroyDescriptorPool(device.device(), descriptorPool, nullptr);
+        });
     }
 
     bool ZeDescriptorPool::allocateDescriptor(
@@ -119,11 +122,13 @@ namespace ze {
     }
 
     void ZeDescriptorPool::freeDescriptors(std::vector<VkDescriptorSet> &descriptors) const {
-        vkFreeDescriptorSets(
-                zeDevice.device(),
-                descriptorPool,
-                static_cast<uint32_t>(descriptors.size()),
-                descriptors.data());
+        zeDevice.destroyDeferred([&device = zeDevice, descriptorPool = descriptorPool, descriptors]() {
+            vkFreeDescriptorSets(
+                    device.device(),
+                    descriptorPool,
+                    static_cast<uint32_t>(descriptors.size()),
+                    descriptors.data());
+        });
     }
 
     void ZeDescriptorPool::resetPool() {
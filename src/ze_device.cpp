@@ -1,9 +1,17 @@
 #include "ze_device.hpp"
+#include "ze_frame_scheduler.hpp"
+#include "ze_pipeline_library.hpp"
+#include "ze_utils.hpp"
 
 // std headers
+#include <cassert>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <set>
+#include <sstream>
 #include <unordered_set>
 
 namespace ze {
@@ -47,24 +55,52 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-ZeDevice::ZeDevice(ZeWindow &window) : window{window} {
+ZeDevice::ZeDevice(ZeWindow &window) : window{&window} {
+  deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+  init();
+}
+
+ZeDevice::ZeDevice() : window{nullptr} { init(); }
+
+void ZeDevice::init() {
   createInstance();
   setupDebugMessenger();
   createSurface();
   pickPhysicalDevice();
   createLogicalDevice();
-  createCommandPool();
+  createPipelineCache();
+  pipelineLibrary_ = std::make_unique<ZePipelineLibrary>(*this);
+  allocator_ = std::make_unique<ZeMemoryAllocator>(device_, physicalDevice);
 }
 
 ZeDevice::~ZeDevice() {
-  vkDestroyCommandPool(device_, commandPool, nullptr);
+  // waits for the pipelines still compiling, before the cache is saved
+  pipelineLibrary_.reset();
+  for (auto &kv : threadCommandPools_) {
+    for (auto *pool : {&kv.second.graphics, &kv.second.transfer}) {
+      if (pool->commandPool == VK_NULL_HANDLE) continue;
+      vkDestroyFence(device_, pool->fence, nullptr);
+      vkDestroyCommandPool(device_, pool->commandPool, nullptr);
+    }
+    vkDestroySemaphore(device_, kv.second.transferDone, nullptr);
+  }
+  allocator_.reset();
+  try {
+    savePipelineCache();
+  } catch (const std::exception &e) {
+    // the next start is only slower
+    std::cerr << e.what() << std::endl;
+  }
+  vkDestroyPipelineCache(device_, pipelineCache_, nullptr);
   vkDestroyDevice(device_, nullptr);
 
   if (enableValidationLayers) {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
+  if (surface_ != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance, surface_, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -79,7 +115,8 @@ void ZeDevice::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  // timeline semaphores pace the frames
+  appInfo.apiVersion = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -137,7 +174,8 @@ void ZeDevice::createLogicalDevice() {
   QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
   std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-  std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily, indices.presentFamily};
+  std::set<uint32_t> uniqueQueueFamilies = {
+      indices.graphicsFamily, indices.presentFamily, indices.transferFamily};
 
   float queuePriority = 1.0f;
   for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -152,8 +190,13 @@ void ZeDevice::createLogicalDevice() {
   VkPhysicalDeviceFeatures deviceFeatures = {};
   deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+  VkPhysicalDeviceVulkan12Features deviceFeatures12 = {};
+  deviceFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  deviceFeatures12.timelineSemaphore = VK_TRUE;
+
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+  createInfo.pNext = &deviceFeatures12;
 
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
@@ -177,31 +220,181 @@ void ZeDevice::createLogicalDevice() {
 
   vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
   vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+  vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+  graphicsFamily_ = indices.graphicsFamily;
+  transferFamily_ = indices.transferFamily;
 }
 
-void ZeDevice::createCommandPool() {
-  QueueFamilyIndices queueFamilyIndices = findPhysicalQueueFamilies();
-
+void ZeDevice::createThreadCommandPool(uint32_t queueFamily, ThreadCommandPool &pool) {
   VkCommandPoolCreateInfo poolInfo = {};
   poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-  poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-  poolInfo.flags =
-      VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+  poolInfo.queueFamilyIndex = queueFamily;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  if (vkCreateCommandPool(device_, &poolInfo, nullptr, &pool.commandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create thread command pool!");
+  }
+
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  if (vkCreateFence(device_, &fenceInfo, nullptr, &pool.fence) != VK_SUCCESS) {
+    vkDestroyCommandPool(device_, pool.commandPool, nullptr);
+    throw std::runtime_error("failed to create single time commands fence!");
+  }
+}
+
+ZeDevice::ThreadCommandPools &ZeDevice::threadCommandPools() {
+  std::lock_guard<std::mutex> lock{threadCommandPoolsMutex};
+  auto it = threadCommandPools_.find(std::this_thread::get_id());
+  if (it != threadCommandPools_.end()) {
+    return it->second;
+  }
 
-  if (vkCreateCommandPool(device_, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
-    throw std::runtime_error("failed to create command pool!");
+  // unordered_map references stay valid when other threads insert
+  auto &pools = threadCommandPools_[std::this_thread::get_id()];
+  createThreadCommandPool(graphicsFamily_, pools.graphics);
+  if (hasDedicatedTransferQueue()) {
+    createThreadCommandPool(transferFamily_, pools.transfer);
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &pools.transferDone) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create single time transfer semaphore!");
+    }
+  }
+  return pools;
+}
+
+void ZeDevice::destroyDeferred(std::function<void()> destroy) {
+  {
+    std::lock_guard<std::mutex> lock{frameSchedulerMutex};
+    if (frameScheduler != nullptr) {
+      frameScheduler->retire(std::move(destroy));
+      return;
+    }
   }
+  destroy();
+}
+
+void ZeDevice::setFrameScheduler(ZeFrameScheduler *scheduler) {
+  std::lock_guard<std::mutex> lock{frameSchedulerMutex};
+  assert((scheduler == nullptr || frameScheduler == nullptr) && "a frame scheduler is already attached");
+  frameScheduler = scheduler;
 }
 
-void ZeDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
+void ZeDevice::waitIdle() {
+  // every queue of the device must be externally synchronized
+  std::scoped_lock lock{queueMutex_, transferQueueMutex_};
+  vkDeviceWaitIdle(device_);
+}
+
+std::string ZeDevice::pipelineCachePath() const {
+  std::ostringstream path;
+  path << "pipeline_cache_" << std::hex << std::setfill('0') << properties.vendorID << '_'
+       << properties.deviceID << '_' << properties.driverVersion << '_';
+  for (uint8_t byte : properties.pipelineCacheUUID) {
+    path << std::setw(2) << static_cast<uint32_t>(byte);
+  }
+  path << ".bin";
+  return path.str();
+}
+
+bool ZeDevice::isPipelineCacheValid(const std::vector<char> &data) const {
+  // a cache from another device or driver is rejected by most drivers, but not all of them
+  VkPipelineCacheHeaderVersionOne header;
+  if (data.size() < sizeof(header)) return false;
+  std::memcpy(&header, data.data(), sizeof(header));
+  return header.headerSize >= sizeof(header) && header.headerSize <= data.size() &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+         std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void ZeDevice::createPipelineCache() {
+  const auto path = pipelineCachePath();
+  std::vector<char> data;
+  std::ifstream file{path, std::ios::binary | std::ios::ate};
+  if (file.is_open()) {
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!file || !isPipelineCacheValid(data)) {
+      std::cerr << "ignoring invalid pipeline cache " << path << std::endl;
+      data.clear();
+    }
+  }
+
+  VkPipelineCacheCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  createInfo.initialDataSize = data.size();
+  createInfo.pInitialData = data.empty() ? nullptr : data.data();
+  if (vkCreatePipelineCache(device_, &createInfo, nullptr, &pipelineCache_) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache");
+  }
+  pipelineCacheStats_.warm = !data.empty();
+  pipelineCacheStats_.loadedSize = data.size();
+}
+
+void ZeDevice::savePipelineCache() {
+  size_t size = 0;
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &size, nullptr) != VK_SUCCESS) {
+    throw std::runtime_error("failed to get pipeline cache size");
+  }
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(device_, pipelineCache_, &size, data.data()) != VK_SUCCESS) {
+    throw std::runtime_error("failed to get pipeline cache data");
+  }
+
+  // written aside then renamed, an interrupted save never leaves a truncated cache
+  const auto path = pipelineCachePath();
+  const auto temporaryPath = uniqueTemporaryPath(path);
+  {
+    std::ofstream file{temporaryPath, std::ios::binary | std::ios::trunc};
+    file.write(data.data(), static_cast<std::streamsize>(size));
+    // close() flushes, a short write only shows after it
+    file.close();
+    if (!file) {
+      std::error_code error;
+      std::filesystem::remove(temporaryPath, error);
+      throw std::runtime_error("failed to write pipeline cache " + temporaryPath);
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temporaryPath, path, error);
+  if (error) {
+    const std::string message = error.message();
+    std::filesystem::remove(temporaryPath, error);
+    throw std::runtime_error("failed to save pipeline cache " + path + " : " + message);
+  }
+}
+
+void ZeDevice::addPipelineCreationTime(double milliseconds) {
+  std::lock_guard<std::mutex> lock{pipelineCacheStatsMutex};
+  pipelineCacheStats_.pipelineCount++;
+  pipelineCacheStats_.creationMilliseconds += milliseconds;
+}
+
+void ZeDevice::setPipelineCreationWallTime(double milliseconds) {
+  std::lock_guard<std::mutex> lock{pipelineCacheStatsMutex};
+  pipelineCacheStats_.creationWallMilliseconds = milliseconds;
+}
+
+PipelineCacheStats ZeDevice::pipelineCacheStats() const {
+  std::lock_guard<std::mutex> lock{pipelineCacheStatsMutex};
+  return pipelineCacheStats_;
+}
+
+void ZeDevice::createSurface() {
+  if (isHeadless()) return;
+  window->createWindowSurface(instance, &surface_);
+}
 
 bool ZeDevice::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  // nothing to present to in headless mode
+  bool swapChainAdequate = isHeadless();
+  if (extensionsSupported && !isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -209,8 +402,19 @@ bool ZeDevice::isDeviceSuitable(VkPhysicalDevice device) {
   VkPhysicalDeviceFeatures supportedFeatures;
   vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
+  VkPhysicalDeviceProperties deviceProperties;
+  vkGetPhysicalDeviceProperties(device, &deviceProperties);
+  VkPhysicalDeviceVulkan12Features supportedFeatures12{};
+  supportedFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  if (deviceProperties.apiVersion >= VK_API_VERSION_1_2) {
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &supportedFeatures12;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+  }
+
   return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-         supportedFeatures.samplerAnisotropy;
+         supportedFeatures.samplerAnisotropy && supportedFeatures12.timelineSemaphore;
 }
 
 void ZeDevice::populateDebugMessengerCreateInfo(
@@ -261,11 +465,13 @@ bool ZeDevice::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> ZeDevice::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+  if (!isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -333,7 +539,12 @@ QueueFamilyIndices ZeDevice::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamilyHasValue = true;
     }
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    if (isHeadless()) {
+      // no presentation, the graphics queue stands in for the present queue
+      presentSupport = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+    } else {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -345,6 +556,23 @@ QueueFamilyIndices ZeDevice::findQueueFamilies(VkPhysicalDevice device) {
     i++;
   }
 
+  // streaming uploads go to a queue of their own when there is one : a transfer only family
+  // (copy engine) first, then an async compute family, else they share the graphics queue
+  indices.transferFamily = indices.graphicsFamily;
+  indices.transferFamilyHasValue = indices.graphicsFamilyHasValue;
+  int transferRank = 0;
+  for (uint32_t family = 0; family < queueFamilyCount; family++) {
+    const auto flags = queueFamilies[family].queueFlags;
+    if (queueFamilies[family].queueCount == 0 || flags & VK_QUEUE_GRAPHICS_BIT) continue;
+    // compute queues support transfers even when they don't advertise it
+    int rank = (flags & VK_QUEUE_COMPUTE_BIT) ? 1 : (flags & VK_QUEUE_TRANSFER_BIT) ? 2 : 0;
+    if (rank > transferRank) {
+      indices.transferFamily = family;
+      indices.transferFamilyHasValue = true;
+      transferRank = rank;
+    }
+  }
+
   return indices;
 }
 
@@ -408,7 +636,7 @@ void ZeDevice::createBuffer(
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer &buffer,
-    VkDeviceMemory &bufferMemory) {
+    ZeAllocation &bufferMemory) {
   VkBufferCreateInfo bufferInfo{};
   bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
   bufferInfo.size = size;
@@ -422,53 +650,239 @@ void ZeDevice::createBuffer(
   VkMemoryRequirements memRequirements;
   vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate vertex buffer memory!");
-  }
-
-  vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+  bufferMemory = allocator_->allocate(memRequirements, properties, true);
+  vkBindBufferMemory(device_, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
-VkCommandBuffer ZeDevice::beginSingleTimeCommands() {
-  VkCommandBufferAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  allocInfo.commandPool = commandPool;
-  allocInfo.commandBufferCount = 1;
-
-  VkCommandBuffer commandBuffer;
-  vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer);
+VkCommandBuffer ZeDevice::beginCommands(ThreadCommandPool &pool) {
+  if (pool.usedCount == pool.commandBuffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = pool.commandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(device_, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate single time command buffer!");
+    }
+    pool.commandBuffers.push_back(commandBuffer);
+  }
+  VkCommandBuffer commandBuffer = pool.commandBuffers[pool.usedCount++];
+  pool.pendingCount++;
 
   VkCommandBufferBeginInfo beginInfo{};
   beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-  vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    releaseCommands(pool);
+    throw std::runtime_error("failed to begin single time command buffer!");
+  }
   return commandBuffer;
 }
 
-void ZeDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-  vkEndCommandBuffer(commandBuffer);
+void ZeDevice::submitCommands(
+    VkQueue queue,
+    std::mutex &mutex,
+    VkCommandBuffer commandBuffer,
+    VkSemaphore waitSemaphore,
+    VkSemaphore signalSemaphore,
+    VkFence fence) {
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record single time command buffer!");
+  }
 
+  // the acquire barrier is chained to the semaphore wait by ALL_COMMANDS
+  VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
   VkSubmitInfo submitInfo{};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = &commandBuffer;
+  if (waitSemaphore != VK_NULL_HANDLE) {
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &waitSemaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+  }
+  if (signalSemaphore != VK_NULL_HANDLE) {
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+  }
+
+  std::lock_guard<std::mutex> lock{mutex};
+  if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit single time commands!");
+  }
+}
+
+void ZeDevice::releaseCommands(ThreadCommandPool &pool) {
+  // once no buffer of the thread is being recorded, the pool is reset wholesale
+  if (--pool.pendingCount == 0) {
+    // on failure the buffers stay in use, later ones are allocated anew
+    if (vkResetCommandPool(device_, pool.commandPool, 0) != VK_SUCCESS) {
+      throw std::runtime_error("failed to reset single time command pool!");
+    }
+    pool.usedCount = 0;
+  }
+}
+
+void ZeDevice::waitCommands(ThreadCommandPool &pool) {
+  // the fence is left signaled on failure, the device is lost
+  VkResult result = vkWaitForFences(device_, 1, &pool.fence, VK_TRUE, UINT64_MAX);
+  if (result == VK_SUCCESS) {
+    result = vkResetFences(device_, 1, &pool.fence);
+  }
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to wait for single time commands!");
+  }
+}
+
+VkCommandBuffer ZeDevice::beginSingleTimeCommands() {
+  return beginCommands(threadCommandPools().graphics);
+}
+
+void ZeDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
+  // wait on a fence rather than the whole queue : frames may be in flight on it
+  auto &pool = threadCommandPools().graphics;
+  try {
+    submitCommands(graphicsQueue_, queueMutex_, commandBuffer, VK_NULL_HANDLE, VK_NULL_HANDLE, pool.fence);
+    waitCommands(pool);
+  } catch (const std::exception &) {
+    releaseCommands(pool);
+    throw;
+  }
+  releaseCommands(pool);
+}
 
-  vkQueueSubmit(graphicsQueue_, 1, &submitInfo, VK_NULL_HANDLE);
-  vkQueueWaitIdle(graphicsQueue_);
+VkCommandBuffer ZeDevice::beginTransferCommands() {
+  auto &pools = threadCommandPools();
+  return beginCommands(hasDedicatedTransferQueue() ? pools.transfer : pools.graphics);
+}
+
+void ZeDevice::endTransferCommands(
+    VkCommandBuffer commandBuffer,
+    const std::vector<VkBufferMemoryBarrier> &bufferBarriers,
+    const std::vector<VkImageMemoryBarrier> &imageBarriers) {
+  if (!hasDedicatedTransferQueue()) {
+    // same queue : a plain barrier makes the copies visible to the next submissions
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+        0,
+        0,
+        nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()),
+        bufferBarriers.data(),
+        static_cast<uint32_t>(imageBarriers.size()),
+        imageBarriers.data());
+    endSingleTimeCommands(commandBuffer);
+    return;
+  }
+
+  // release the resources on the transfer queue and acquire them on the graphics queue, the
+  // graphics submission waits on the transfer one through the thread semaphore
+  auto &pools = threadCommandPools();
+  try {
+    recordReleaseBarriers(commandBuffer, bufferBarriers, imageBarriers);
+    submitCommands(
+        transferQueue_, transferQueueMutex_, commandBuffer, VK_NULL_HANDLE, pools.transferDone, VK_NULL_HANDLE);
+  } catch (const std::exception &) {
+    releaseCommands(pools.transfer);
+    throw;
+  }
 
-  vkFreeCommandBuffers(device_, commandPool, 1, &commandBuffer);
+  bool acquireSubmitted = false;
+  try {
+    VkCommandBuffer acquireBuffer = beginCommands(pools.graphics);
+    try {
+      recordAcquireBarriers(acquireBuffer, bufferBarriers, imageBarriers);
+      submitCommands(
+          graphicsQueue_, queueMutex_, acquireBuffer, pools.transferDone, VK_NULL_HANDLE, pools.graphics.fence);
+      acquireSubmitted = true;
+      // the graphics fence signals after the transfer it waited on
+      waitCommands(pools.graphics);
+    } catch (const std::exception &) {
+      releaseCommands(pools.graphics);
+      throw;
+    }
+  } catch (const std::exception &) {
+    if (!acquireSubmitted) {
+      // nothing will wait on the signaled semaphore, replace it once the transfer is done
+      waitIdle();
+      vkDestroySemaphore(device_, pools.transferDone, nullptr);
+      pools.transferDone = VK_NULL_HANDLE;
+      releaseCommands(pools.transfer);
+      VkSemaphoreCreateInfo semaphoreInfo{};
+      semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+      if (vkCreateSemaphore(device_, &semaphoreInfo, nullptr, &pools.transferDone) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create single time transfer semaphore!");
+      }
+      throw;
+    }
+    releaseCommands(pools.transfer);
+    throw;
+  }
+  releaseCommands(pools.graphics);
+  releaseCommands(pools.transfer);
+}
+
+void ZeDevice::recordReleaseBarriers(
+    VkCommandBuffer commandBuffer,
+    std::vector<VkBufferMemoryBarrier> bufferBarriers,
+    std::vector<VkImageMemoryBarrier> imageBarriers) {
+  for (auto &barrier : bufferBarriers) {
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = transferFamily_;
+    barrier.dstQueueFamilyIndex = graphicsFamily_;
+  }
+  for (auto &barrier : imageBarriers) {
+    barrier.dstAccessMask = 0;
+    barrier.srcQueueFamilyIndex = transferFamily_;
+    barrier.dstQueueFamilyIndex = graphicsFamily_;
+  }
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+      0,
+      0,
+      nullptr,
+      static_cast<uint32_t>(bufferBarriers.size()),
+      bufferBarriers.data(),
+      static_cast<uint32_t>(imageBarriers.size()),
+      imageBarriers.data());
+}
+
+void ZeDevice::recordAcquireBarriers(
+    VkCommandBuffer commandBuffer,
+    std::vector<VkBufferMemoryBarrier> bufferBarriers,
+    std::vector<VkImageMemoryBarrier> imageBarriers) {
+  for (auto &barrier : bufferBarriers) {
+    barrier.srcAccessMask = 0;
+    barrier.srcQueueFamilyIndex = transferFamily_;
+    barrier.dstQueueFamilyIndex = graphicsFamily_;
+  }
+  for (auto &barrier : imageBarriers) {
+    barrier.srcAccessMask = 0;
+    barrier.srcQueueFamilyIndex = transferFamily_;
+    barrier.dstQueueFamilyIndex = graphicsFamily_;
+  }
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+      0,
+      0,
+      nullptr,
+      static_cast<uint32_t>(bufferBarriers.size()),
+      bufferBarriers.data(),
+      static_cast<uint32_t>(imageBarriers.size()),
+      imageBarriers.data());
 }
 
 void ZeDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
-    // TODO : use memory barrier
-  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+  VkCommandBuffer commandBuffer = beginTransferCommands();
 
   VkBufferCopy copyRegion{};
   copyRegion.srcOffset = 0;  // Optional
@@ -476,12 +890,44 @@ void ZeDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize s
   copyRegion.size = size;
   vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
-  endSingleTimeCommands(commandBuffer);
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = dstBuffer;
+  barrier.offset = 0;
+  barrier.size = size;
+  endTransferCommands(commandBuffer, {barrier}, {});
 }
 
 void ZeDevice::copyBufferToImage(
     VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount) {
-  VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+  VkCommandBuffer commandBuffer = beginTransferCommands();
+
+  // the layout transition is done on the transfer queue, the previous content is discarded
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layerCount};
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      0,
+      nullptr,
+      0,
+      nullptr,
+      1,
+      &barrier);
 
   VkBufferImageCopy region{};
   region.bufferOffset = 0;
@@ -503,14 +949,20 @@ void ZeDevice::copyBufferToImage(
       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
       1,
       &region);
-  endSingleTimeCommands(commandBuffer);
+
+  // released to the graphics queue ready for sampling, the transition is part of the transfer
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  endTransferCommands(commandBuffer, {}, {barrier});
 }
 
 void ZeDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
     VkImage &image,
-    VkDeviceMemory &imageMemory) {
+    ZeAllocation &imageMemory) {
   if (vkCreateImage(device_, &imageInfo, nullptr, &image) != VK_SUCCESS) {
     throw std::runtime_error("failed to create image!");
   }
@@ -518,16 +970,9 @@ void ZeDevice::createImageWithInfo(
   VkMemoryRequirements memRequirements;
   vkGetImageMemoryRequirements(device_, image, &memRequirements);
 
-  VkMemoryAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  allocInfo.allocationSize = memRequirements.size;
-  allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-  if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-    throw std::runtime_error("failed to allocate image memory!");
-  }
-
-  if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) {
+  imageMemory = allocator_->allocate(
+      memRequirements, properties, imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
+  if (vkBindImageMemory(device_, image, imageMemory.memory, imageMemory.offset) != VK_SUCCESS) {
     throw std::runtime_error("failed to bind image memory!");
   }
 }
@@ -1,13 +1,22 @@
 #pragma once
 
+#include "ze_memory_allocator.hpp"
 #include "ze_window.hpp"
 
 // std lib headers
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace ze {
 
+class ZeFrameScheduler;
+class ZePipelineLibrary;
+
 struct SwapChainSupportDetails {
   VkSurfaceCapabilitiesKHR capabilities;
   std::vector<VkSurfaceFormatKHR> formats;
@@ -17,11 +26,25 @@ struct SwapChainSupportDetails {
 struct QueueFamilyIndices {
   uint32_t graphicsFamily;
   uint32_t presentFamily;
+  // the graphics family when the device has no separate transfer capable family
+  uint32_t transferFamily;
   bool graphicsFamilyHasValue = false;
   bool presentFamilyHasValue = false;
+  bool transferFamilyHasValue = false;
   bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 };
 
+struct PipelineCacheStats {
+  // a valid cache file was loaded, pipeline creation is warm
+  bool warm = false;
+  size_t loadedSize = 0;
+  uint32_t pipelineCount = 0;
+  // summed over the pipelines, created in parallel
+  double creationMilliseconds = 0.0;
+  // from the first pipeline requested to the last one created
+  double creationWallMilliseconds = 0.0;
+};
+
 class ZeDevice {
  public:
 #ifdef NDEBUG
@@ -31,6 +54,8 @@ class ZeDevice {
 #endif
 
   ZeDevice(ZeWindow &window);
+  // headless : no surface and no swap chain extension, render into a ZeOffscreenTarget
+  ZeDevice();
   ~ZeDevice();
 
   // Not copyable or movable
@@ -40,11 +65,41 @@ class ZeDevice {
   ZeDevice(ZeDevice &&) = delete;
   ZeDevice &operator=(ZeDevice &&) = delete;
 
-  VkCommandPool getCommandPool() { return commandPool; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
+  bool isHeadless() const { return window == nullptr; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
+  // streaming uploads are submitted here, resources written on it must be handed to the
+  // graphics family with queue family ownership transfers when it is a dedicated queue
+  VkQueue transferQueue() { return transferQueue_; }
+  bool hasDedicatedTransferQueue() const { return transferFamily_ != graphicsFamily_; }
+  uint32_t graphicsQueueFamily() const { return graphicsFamily_; }
+  uint32_t transferQueueFamily() const { return transferFamily_; }
+  // must be held while submitting to or waiting on the queues from any thread
+  std::mutex &queueMutex() { return queueMutex_; }
+  std::mutex &transferQueueMutex() {
+    return hasDedicatedTransferQueue() ? transferQueueMutex_ : queueMutex_;
+  }
+  void waitIdle();
+  // loaded from the cache file of the device and driver when it has a valid header, saved back
+  // to it when the device is destroyed
+  VkPipelineCache pipelineCache() { return pipelineCache_; }
+  // shared shader modules and pipelines compiled on worker threads, used by ZePipeline
+  ZePipelineLibrary &pipelineLibrary() { return *pipelineLibrary_; }
+  void savePipelineCache();
+  // pipelines report their creation time, to compare cold and warm starts
+  void addPipelineCreationTime(double milliseconds);
+  void setPipelineCreationWallTime(double milliseconds);
+  PipelineCacheStats pipelineCacheStats() const;
+  // buffers and images memory is sub-allocated from large blocks
+  ZeMemoryAllocator &allocator() { return *allocator_; }
+  // for resources released while frames may still read them : destroy runs once the frames
+  // submitted so far and the one being recorded are complete, right away when no frame
+  // scheduler is attached. Can be called from any thread
+  void destroyDeferred(std::function<void()> destroy);
+  // the frame scheduler attaches itself for its lifetime
+  void setFrameScheduler(ZeFrameScheduler *scheduler);
 
   SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
   uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -58,10 +113,34 @@ class ZeDevice {
       VkBufferUsageFlags usage,
       VkMemoryPropertyFlags properties,
       VkBuffer &buffer,
-      VkDeviceMemory &bufferMemory);
+      ZeAllocation &bufferMemory);
+  // single time commands can be used from any thread, each thread gets its own command pool, its
+  // buffers and fence are reused from one call to the next
   VkCommandBuffer beginSingleTimeCommands();
   void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+  // same, on the transfer queue : the barriers are given as for a single queue (access masks of
+  // the copies and of the later reads, families ignored) and turned into a release on the
+  // transfer queue and an acquire on the graphics queue, which waits on it with a semaphore
+  VkCommandBuffer beginTransferCommands();
+  void endTransferCommands(
+      VkCommandBuffer commandBuffer,
+      const std::vector<VkBufferMemoryBarrier> &bufferBarriers,
+      const std::vector<VkImageMemoryBarrier> &imageBarriers);
+  // the two halves of the ownership transfers from the transfer family to the graphics family,
+  // barriers given as for endTransferCommands
+  void recordReleaseBarriers(
+      VkCommandBuffer commandBuffer,
+      std::vector<VkBufferMemoryBarrier> bufferBarriers,
+      std::vector<VkImageMemoryBarrier> imageBarriers);
+  void recordAcquireBarriers(
+      VkCommandBuffer commandBuffer,
+      std::vector<VkBufferMemoryBarrier> bufferBarriers,
+      std::vector<VkImageMemoryBarrier> imageBarriers);
+  // the destination must not have been used on the graphics queue yet : with a dedicated transfer
+  // queue its previous content is not kept
   void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+  // the image previous content is discarded, it ends in SHADER_READ_ONLY_OPTIMAL owned by the
+  // graphics queue
   void copyBufferToImage(
       VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
@@ -69,17 +148,48 @@ class ZeDevice {
       const VkImageCreateInfo &imageInfo,
       VkMemoryPropertyFlags properties,
       VkImage &image,
-      VkDeviceMemory &imageMemory);
+      ZeAllocation &imageMemory);
 
   VkPhysicalDeviceProperties properties;
 
  private:
+  void init();
   void createInstance();
   void setupDebugMessenger();
   void createSurface();
   void pickPhysicalDevice();
   void createLogicalDevice();
-  void createCommandPool();
+  void createPipelineCache();
+  // keyed by vendor, device, driver version and pipelineCacheUUID
+  std::string pipelineCachePath() const;
+  bool isPipelineCacheValid(const std::vector<char> &data) const;
+  struct ThreadCommandPool {
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    std::vector<VkCommandBuffer> commandBuffers;
+    // buffers handed out since the last reset of the pool
+    size_t usedCount = 0;
+    size_t pendingCount = 0;
+  };
+  struct ThreadCommandPools {
+    ThreadCommandPool graphics;
+    // only with a dedicated transfer queue
+    ThreadCommandPool transfer;
+    VkSemaphore transferDone = VK_NULL_HANDLE;
+  };
+  ThreadCommandPools &threadCommandPools();
+  void createThreadCommandPool(uint32_t queueFamily, ThreadCommandPool &pool);
+  VkCommandBuffer beginCommands(ThreadCommandPool &pool);
+  void submitCommands(
+      VkQueue queue,
+      std::mutex &mutex,
+      VkCommandBuffer commandBuffer,
+      VkSemaphore waitSemaphore,
+      VkSemaphore signalSemaphore,
+      VkFence fence);
+  void releaseCommands(ThreadCommandPool &pool);
+  // waits for and resets the fence of the pool
+  void waitCommands(ThreadCommandPool &pool);
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
@@ -94,16 +204,30 @@ class ZeDevice {
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-  ZeWindow &window;
-  VkCommandPool commandPool;
+  ZeWindow *window;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkQueue transferQueue_;
+  uint32_t graphicsFamily_;
+  uint32_t transferFamily_;
+  std::mutex queueMutex_;
+  std::mutex transferQueueMutex_;
+  std::unique_ptr<ZeMemoryAllocator> allocator_;
+  VkPipelineCache pipelineCache_ = VK_NULL_HANDLE;
+  std::unique_ptr<ZePipelineLibrary> pipelineLibrary_;
+  mutable std::mutex pipelineCacheStatsMutex;
+  PipelineCacheStats pipelineCacheStats_;
+  std::mutex frameSchedulerMutex;
+  ZeFrameScheduler *frameScheduler = nullptr;
+
+  std::mutex threadCommandPoolsMutex;
+  std::unordered_map<std::thread::id, ThreadCommandPools> threadCommandPools_;
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-  const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  std::vector<const char *> deviceExtensions;
 };
 
 }  // namespace lve
\ No newline at end of file
@@ -0,0 +1,82 @@
+#include "ze_draw_list.hpp"
+
+#include <array>
+#include <cstring>
+#include <utility>
+
+namespace ze {
+
+    // 11 bits per pass : 3 passes for a depth alone, with histograms small enough to stay cached
+    static constexpr uint32_t RADIX_BITS = 11;
+    static constexpr uint32_t RADIX_BUCKETS = 1 << RADIX_BITS;
+    static constexpr uint32_t MAX_RADIX_PASSES = (64 + RADIX_BITS - 1) / RADIX_BITS;
+
+    uint64_t ZeDrawList::makeKey(float depth, uint16_t pipeline, uint16_t material) {
+        // positive floats order as their bits, inverted for the farther ones to come first
+        uint32_t depthBits;
+        std::memcpy(&depthBits, &depth, sizeof(depthBits));
+        if (depthBits & 0x80000000u) {
+            depthBits = 0;
+        }
+        return (static_cast<uint64_t>(~depthBits) << 32) |
+               (static_cast<uint64_t>(pipeline) << 16) |
+               static_cast<uint64_t>(material);
+    }
+
+    void ZeDrawList::reserve(size_t count) {
+        items.reserve(count);
+        scratch.reserve(count);
+    }
+
+    void ZeDrawList::sort() {
+        if (items.size() < 2) {
+            return;
+        }
+        // only the bits that differ between the keys are sorted, the unused key fields (constant
+        // pipeline or material) cost nothing
+        uint64_t anyBits = 0;
+        uint64_t allBits = ~uint64_t{0};
+        for (const auto &item : items) {
+            anyBits |= item.key;
+            allBits &= item.key;
+        }
+        const uint64_t varyingBits = anyBits ^ allBits;
+        if (varyingBits == 0) {
+            return;
+        }
+        uint32_t lowBit = 0;
+        while (((varyingBits >> lowBit) & 1) == 0) lowBit++;
+        uint32_t highBit = 63;
+        while (((varyingBits >> highBit) & 1) == 0) highBit--;
+        const uint32_t passCount = (highBit - lowBit) / RADIX_BITS + 1;
+
+        // the histograms of every pass in one read of the keys
+        std::array<std::array<uint32_t, RADIX_BUCKETS>, MAX_RADIX_PASSES> histograms;
+        for (uint32_t pass = 0; pass < passCount; pass++) {
+            histograms[pass].fill(0);
+        }
+        for (const auto &item : items) {
+            const uint64_t key = item.key >> lowBit;
+            for (uint32_t pass = 0; pass < passCount; pass++) {
+                histograms[pass][(key >> (pass * RADIX_BITS)) & (RADIX_BUCKETS - 1)]++;
+            }
+        }
+
+        scratch.resize(items.size());
+        for (uint32_t pass = 0; pass < passCount; pass++) {
+            const uint32_t shift = lowBit + pass * RADIX_BITS;
+            auto &histogram = histograms[pass];
+            uint32_t offset = 0;
+            for (auto &count : histogram) {
+                uint32_t bucketSize = count;
+                count = offset;
+                offset += bucketSize;
+            }
+            for (const auto &item : items) {
+                scratch[histogram[(item.key >> shift) & (RADIX_BUCKETS - 1)]++] = item;
+            }
+            std::swap(items, scratch);
+        }
+    }
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ze {
+
+    // Draw items ordered by a 64 bit key with a radix sort, in storage kept between frames :
+    // nothing is allocated once the list has reached its largest size. Keys from makeKey() order
+    // the transparent draws back to front, then by pipeline and material.
+    class ZeDrawList {
+    public:
+        struct Item {
+            uint64_t key;
+            // index of the draw data in the caller's arrays
+            uint32_t payload;
+        };
+
+        // depth is any non negative value growing with the distance to the camera (view depth,
+        // squared distance), farther items come first
+        static uint64_t makeKey(float depth, uint16_t pipeline = 0, uint16_t material = 0);
+
+        void clear() { items.clear(); }
+        void reserve(size_t count);
+        void add(uint64_t key, uint32_t payload) { items.push_back({key, payload}); }
+        // ascending keys, items of equal keys keep their order
+        void sort();
+
+        size_t size() const { return items.size(); }
+        bool empty() const { return items.empty(); }
+        std::vector<Item>::const_iterator begin() const { return items.begin(); }
+        std::vector<Item>::const_iterator end() const { return items.end(); }
+
+    private:
+        std::vector<Item> items;
+        // target of the scatter passes, swapped with items after each one
+        std::vector<Item> scratch;
+    };
+
+}
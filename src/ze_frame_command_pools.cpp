@@ -0,0 +1,66 @@
+#include "ze_frame_command_pools.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace ze {
+
+    ZeFrameCommandPools::ZeFrameCommandPools(ZeDevice &device, uint32_t frameCount, uint32_t slotCount):
+            zeDevice{device}, slotCount{slotCount}, frames(frameCount) {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = zeDevice.findPhysicalQueueFamilies().graphicsFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        for (auto &frame : frames) {
+            frame.resize(slotCount);
+            for (auto &slot : frame) {
+                if (vkCreateCommandPool(zeDevice.device(), &poolInfo, nullptr, &slot.commandPool) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create frame command pool");
+                }
+            }
+        }
+    }
+
+    ZeFrameCommandPools::~ZeFrameCommandPools() {
+        // destroying a pool frees its buffers
+        for (auto &frame : frames) {
+            for (auto &slot : frame) {
+                vkDestroyCommandPool(zeDevice.device(), slot.commandPool, nullptr);
+            }
+        }
+    }
+
+    void ZeFrameCommandPools::reset(int frameIndex) {
+        for (auto &slot : frames[frameIndex]) {
+            if (slot.usedPrimaryCount == 0 && slot.usedSecondaryCount == 0) continue;
+            if (vkResetCommandPool(zeDevice.device(), slot.commandPool, 0) != VK_SUCCESS) {
+                throw std::runtime_error("failed to reset frame command pool");
+            }
+            slot.usedPrimaryCount = 0;
+            slot.usedSecondaryCount = 0;
+        }
+    }
+
+    VkCommandBuffer ZeFrameCommandPools::allocate(int frameIndex, uint32_t slot, VkCommandBufferLevel level) {
+        assert(slot < slotCount && "frame command pool slot out of range");
+        auto &slotPool = frames[frameIndex][slot];
+        const bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        auto &buffers = primary ? slotPool.primaryBuffers : slotPool.secondaryBuffers;
+        auto &usedCount = primary ? slotPool.usedPrimaryCount : slotPool.usedSecondaryCount;
+
+        if (usedCount == buffers.size()) {
+            VkCommandBufferAllocateInfo allocateInfo{};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.level = level;
+            allocateInfo.commandPool = slotPool.commandPool;
+            allocateInfo.commandBufferCount = 1;
+            VkCommandBuffer commandBuffer;
+            if (vkAllocateCommandBuffers(zeDevice.device(), &allocateInfo, &commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate frame command buffer");
+            }
+            buffers.push_back(commandBuffer);
+        }
+        return buffers[usedCount++];
+    }
+
+}
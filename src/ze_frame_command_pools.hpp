@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ze_device.hpp"
+
+#include <vector>
+
+namespace ze {
+
+    // Transient command pools, one per frame in flight and per recording slot (a thread recording
+    // at a time). Buffers are never freed one by one : the pools of a frame are reset wholesale
+    // once the GPU is done with it, and their buffers handed out again.
+    class ZeFrameCommandPools {
+    public:
+        ZeFrameCommandPools(ZeDevice &device, uint32_t frameCount, uint32_t slotCount);
+        ~ZeFrameCommandPools();
+
+        ZeFrameCommandPools(const ZeFrameCommandPools &) = delete;
+        ZeFrameCommandPools &operator=(const ZeFrameCommandPools &) = delete;
+
+        uint32_t getSlotCount() const { return slotCount; }
+
+        // the previous use of the frame must be complete, invalidates the buffers of the frame
+        void reset(int frameIndex);
+
+        // a buffer in the initial state, valid until the next reset of the frame, each slot must
+        // be used by one thread at a time
+        VkCommandBuffer allocate(int frameIndex, uint32_t slot, VkCommandBufferLevel level);
+
+    private:
+        struct SlotPool {
+            VkCommandPool commandPool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> primaryBuffers;
+            std::vector<VkCommandBuffer> secondaryBuffers;
+            size_t usedPrimaryCount = 0;
+            size_t usedSecondaryCount = 0;
+        };
+
+        ZeDevice &zeDevice;
+        uint32_t slotCount;
+        std::vector<std::vector<SlotPool>> frames;
+    };
+
+}
@@ -2,15 +2,28 @@
 
 #include "ze_camera.hpp"
 #include "ze_game_object.hpp"
+#include "ze_frame_ring.hpp"
+#include "ze_parallel_recorder.hpp"
 
 #include <vulkan/vulkan.h>
 
+#include <array>
+
 namespace ze {
 
-#define MAX_LIGHTS 10
+    // bindings of the global descriptor set, all dynamic, allocated from the frame ring
+    enum GlobalBinding : uint32_t {
+        GLOBAL_UBO_BINDING,
+        // PointLight array
+        GLOBAL_LIGHTS_BINDING,
+        // offset in the light indices and light count of each cluster
+        GLOBAL_LIGHT_CLUSTERS_BINDING,
+        GLOBAL_LIGHT_INDICES_BINDING,
+        GLOBAL_BINDING_COUNT
+    };
 
     struct PointLight {
-        glm::vec4 position{}; // ignore w
+        glm::vec4 position{}; // w is range
         glm::vec4 color{}; // w is intensity
     };
 
@@ -19,8 +32,8 @@ namespace ze {
         glm::mat4 view{1.0f};
         glm::mat4 inverseView{1.0f};
         glm::vec4 ambientLightColor{1.0f, 1.0f, 1.0f, 0.02f}; // RGB + intensity
-        PointLight pointLights[MAX_LIGHTS];
-        int numLights;
+        glm::uvec4 clusterCount{1, 1, 1, 0}; // x tiles, y tiles, depth slices, number of lights
+        glm::vec4 clusterDepth{}; // slice = log(view depth) * x + y
     };
 
     struct FrameInfo {
@@ -28,8 +41,15 @@ namespace ze {
         float frameTime;
         VkCommandBuffer commandBuffer;
         ZeCamera &camera;
+        // bound with globalOffsets
         VkDescriptorSet globalDescriptorSet;
         ZeGameObject::Map &gameObjects;
+        // when set, systems record into its secondary buffers instead of commandBuffer
+        ZeParallelRecorder *recorder = nullptr;
+        // per draw data of the frame, begun on the frame index
+        ZeFrameRing *frameRing = nullptr;
+        // dynamic offsets of the global set, in binding order
+        std::array<uint32_t, GLOBAL_BINDING_COUNT> globalOffsets{};
     };
 
 }
\ No newline at end of file
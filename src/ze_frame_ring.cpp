@@ -0,0 +1,40 @@
+#include "ze_frame_ring.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace ze {
+
+    ZeFrameRing::ZeFrameRing(ZeDevice &device, uint32_t frameCount, VkDeviceSize frameCapacity,
+                             VkDeviceSize descriptorRange) {
+        const auto &limits = device.properties.limits;
+        uniformAlignment = limits.minUniformBufferOffsetAlignment;
+        storageAlignment = limits.minStorageBufferOffsetAlignment;
+        // every frame region starts aligned for any kind of allocation
+        this->frameCapacity = ZeBuffer::getAlignment(frameCapacity, std::max(uniformAlignment, storageAlignment));
+
+        // coherent : nothing to flush before submitting
+        buffer = std::make_unique<ZeBuffer>(
+                device,
+                this->frameCapacity * frameCount + descriptorRange,
+                1,
+                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        buffer->map();
+    }
+
+    void ZeFrameRing::beginFrame(int frameIndex) {
+        frameBegin = static_cast<VkDeviceSize>(frameIndex) * frameCapacity;
+        head = frameBegin;
+    }
+
+    ZeFrameRing::Allocation ZeFrameRing::allocate(VkDeviceSize size, VkDeviceSize alignment) {
+        VkDeviceSize offset = ZeBuffer::getAlignment(head, alignment);
+        if (offset + size > frameBegin + frameCapacity) {
+            throw std::runtime_error("frame ring buffer region is full");
+        }
+        head = offset + size;
+        return {static_cast<char *>(buffer->getMappedMemory()) + offset, static_cast<uint32_t>(offset)};
+    }
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "ze_buffer.hpp"
+#include "ze_device.hpp"
+
+#include <memory>
+
+namespace ze {
+
+    // Per frame data (uniforms, storage, instances) bump allocated from a single persistently
+    // mapped buffer, one region per frame in flight. Allocations are offsets into the buffer, used
+    // as dynamic descriptor offsets or vertex buffer offsets, and are valid until the frame slot
+    // comes around again : nothing is created or freed while recording. Not thread safe, allocate
+    // on the recording thread and hand the blocks to the workers.
+    class ZeFrameRing {
+    public:
+        static constexpr VkDeviceSize DEFAULT_FRAME_CAPACITY = 4 * 1024 * 1024;
+
+        struct Allocation {
+            void *data;
+            // from the start of getBuffer()
+            uint32_t offset;
+        };
+
+        // descriptorRange pads the buffer past the last frame region, so that a dynamic descriptor
+        // of up to that range is valid at the offset of any allocation
+        ZeFrameRing(ZeDevice &device, uint32_t frameCount, VkDeviceSize frameCapacity = DEFAULT_FRAME_CAPACITY,
+                    VkDeviceSize descriptorRange = 0);
+
+        ZeFrameRing(const ZeFrameRing &) = delete;
+        ZeFrameRing &operator=(const ZeFrameRing &) = delete;
+
+        VkBuffer getBuffer() const { return buffer->getBuffer(); }
+        VkDeviceSize getFrameCapacity() const { return frameCapacity; }
+        // for dynamic uniform or storage buffer descriptors of range bytes at the allocated offsets,
+        // range is at most the allocation size or the descriptorRange of the constructor
+        VkDescriptorBufferInfo descriptorInfo(VkDeviceSize range) const { return {buffer->getBuffer(), 0, range}; }
+
+        // the previous use of the frame slot must be complete, releases its allocations
+        void beginFrame(int frameIndex);
+
+        // throws when the frame region is full, alignment is a power of two
+        Allocation allocate(VkDeviceSize size, VkDeviceSize alignment);
+        Allocation allocateUniform(VkDeviceSize size) { return allocate(size, uniformAlignment); }
+        Allocation allocateStorage(VkDeviceSize size) { return allocate(size, storageAlignment); }
+
+        // copies value into a uniform allocation and returns its dynamic offset
+        template<typename T>
+        uint32_t pushUniform(const T &value) {
+            auto allocation = allocateUniform(sizeof(T));
+            *static_cast<T *>(allocation.data) = value;
+            return allocation.offset;
+        }
+
+    private:
+        std::unique_ptr<ZeBuffer> buffer;
+        VkDeviceSize uniformAlignment;
+        VkDeviceSize storageAlignment;
+        VkDeviceSize frameCapacity;
+
+        // current frame region, in bytes from the start of the buffer
+        VkDeviceSize frameBegin{0};
+        VkDeviceSize head{0};
+    };
+
+}
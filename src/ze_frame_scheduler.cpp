@@ -0,0 +1,122 @@
+#include "ze_frame_scheduler.hpp"
+#include "ze_cpu_profiler.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace ze {
+
+    ZeFrameScheduler::ZeFrameScheduler(ZeDevice &device, uint32_t framesInFlight):
+            zeDevice{device}, framesInFlight{framesInFlight} {
+        if (framesInFlight == 0) {
+            throw std::runtime_error("frame scheduler needs at least one frame in flight");
+        }
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        createInfo.pNext = &typeInfo;
+        if (vkCreateSemaphore(zeDevice.device(), &createInfo, nullptr, &timelineSemaphore) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create frame timeline semaphore");
+        }
+        zeDevice.setFrameScheduler(this);
+    }
+
+    ZeFrameScheduler::~ZeFrameScheduler() {
+        // once the frames are complete, resources released after the detach can go right away
+        wait(submittedValue);
+        zeDevice.setFrameScheduler(nullptr);
+        runRetired(std::numeric_limits<uint64_t>::max());
+        vkDestroySemaphore(zeDevice.device(), timelineSemaphore, nullptr);
+    }
+
+    void ZeFrameScheduler::beginFrame() {
+        // the slot was last used framesInFlight frames ago
+        uint64_t value = getFrameValue();
+        if (value > framesInFlight) {
+            ZE_PROFILE_SCOPE("wait frame");
+            wait(value - framesInFlight);
+        }
+        collect();
+    }
+
+    VkResult ZeFrameScheduler::submit(VkQueue queue, const VkSubmitInfo &submitInfo) {
+        // binary semaphores ignore their value, only the timeline one needs it
+        signalSemaphores.assign(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+        signalValues.assign(submitInfo.signalSemaphoreCount, 0);
+        signalSemaphores.push_back(timelineSemaphore);
+        signalValues.push_back(getFrameValue());
+
+        VkTimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timelineInfo.pNext = submitInfo.pNext;
+        timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
+        timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+        VkSubmitInfo frameSubmitInfo = submitInfo;
+        frameSubmitInfo.pNext = &timelineInfo;
+        frameSubmitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+        frameSubmitInfo.pSignalSemaphores = signalSemaphores.data();
+
+        VkResult result = vkQueueSubmit(queue, 1, &frameSubmitInfo, VK_NULL_HANDLE);
+        if (result == VK_SUCCESS) {
+            submittedValue++;
+        }
+        return result;
+    }
+
+    void ZeFrameScheduler::retire(uint64_t value, std::function<void()> fn) {
+        std::lock_guard<std::mutex> lock{retiredMutex};
+        auto position = std::upper_bound(retired.begin(), retired.end(), value, [](uint64_t value, const Retired &entry) {
+            return value < entry.value;
+        });
+        retired.insert(position, Retired{value, std::move(fn)});
+    }
+
+    void ZeFrameScheduler::collect() {
+        runRetired(completedValue());
+    }
+
+    void ZeFrameScheduler::runRetired(uint64_t completed) {
+        while (true) {
+            std::function<void()> fn;
+            {
+                std::lock_guard<std::mutex> lock{retiredMutex};
+                if (retired.empty() || retired.front().value > completed) {
+                    return;
+                }
+                fn = std::move(retired.front().fn);
+                retired.pop_front();
+            }
+            // unlocked, the callback may retire more work
+            fn();
+        }
+    }
+
+    uint64_t ZeFrameScheduler::completedValue() {
+        uint64_t value;
+        if (vkGetSemaphoreCounterValue(zeDevice.device(), timelineSemaphore, &value) != VK_SUCCESS) {
+            throw std::runtime_error("failed to read frame timeline semaphore");
+        }
+        return value;
+    }
+
+    void ZeFrameScheduler::wait(uint64_t value) {
+        if (value == 0) {
+            return;
+        }
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores = &timelineSemaphore;
+        waitInfo.pValues = &value;
+        if (vkWaitSemaphores(zeDevice.device(), &waitInfo, std::numeric_limits<uint64_t>::max()) != VK_SUCCESS) {
+            throw std::runtime_error("failed to wait for frame timeline semaphore");
+        }
+    }
+
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ze_device.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace ze {
+
+    // Paces the frames in flight with one timeline semaphore : frame N signals the value N when the
+    // GPU is done with it, so starting a frame is a single wait on the value of the frame that last
+    // used its slot. Work that must wait for the GPU (destroying a resource a frame still reads) is
+    // queued with retire() and run once the semaphore passes the frame value. The scheduler is
+    // attached to the device for its lifetime, ZeDevice::destroyDeferred() retires through it.
+    class ZeFrameScheduler {
+    public:
+        static constexpr uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+        // throws when framesInFlight is 0
+        ZeFrameScheduler(ZeDevice &device, uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
+        // waits for the submitted frames and runs every retired callback
+        ~ZeFrameScheduler();
+
+        ZeFrameScheduler(const ZeFrameScheduler &) = delete;
+        ZeFrameScheduler &operator=(const ZeFrameScheduler &) = delete;
+
+        uint32_t getFramesInFlight() const { return framesInFlight; }
+        // value signaled by the frame being recorded (the next one between frames)
+        uint64_t getFrameValue() const { return submittedValue + 1; }
+        // slot of the frame being recorded, for the per frame resources
+        int getFrameIndex() const { return static_cast<int>(getFrameValue() % framesInFlight); }
+        VkSemaphore getTimelineSemaphore() const { return timelineSemaphore; }
+
+        // waits until the GPU is done with the previous frame of the slot, then runs the retired
+        // callbacks it passed. A started frame that is never submitted is started again by the
+        // next call, with the same value and slot
+        void beginFrame();
+        // submits the frame with the timeline signal appended to submitInfo, the caller holds the
+        // queue mutex. Returns the vkQueueSubmit result, the frame is submitted on VK_SUCCESS
+        VkResult submit(VkQueue queue, const VkSubmitInfo &submitInfo);
+
+        // runs fn once every frame submitted so far and the frame being recorded are complete
+        void retire(std::function<void()> fn) { retire(getFrameValue(), std::move(fn)); }
+        // runs fn once the timeline semaphore reaches value, from beginFrame() or collect() on the
+        // thread of the frames. Can be called from any thread
+        void retire(uint64_t value, std::function<void()> fn);
+        // runs the retired callbacks whose value has been reached, without waiting
+        void collect();
+
+        uint64_t completedValue();
+        void wait(uint64_t value);
+
+    private:
+        struct Retired {
+            uint64_t value;
+            std::function<void()> fn;
+        };
+
+        void runRetired(uint64_t completed);
+
+        ZeDevice &zeDevice;
+        uint32_t framesInFlight;
+        VkSemaphore timelineSemaphore = VK_NULL_HANDLE;
+        // read by the threads retiring resources
+        std::atomic<uint64_t> submittedValue{0};
+
+        // sorted by value, callbacks of a same value run in the order they were retired
+        std::mutex retiredMutex;
+        std::deque<Retired> retired;
+        std::vector<uint64_t> signalValues;
+        std::vector<VkSemaphore> signalSemaphores;
+    };
+
+}
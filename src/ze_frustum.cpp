@@ -0,0 +1,84 @@
+#include "ze_frustum.hpp"
+#include "ze_simd.hpp"
+
+namespace ze {
+
+    ZeFrustum::ZeFrustum(const glm::mat4 &projectionView) {
+        // rows of the column major matrix
+        glm::vec4 row0{projectionView[0][0], projectionView[1][0], projectionView[2][0], projectionView[3][0]};
+        glm::vec4 row1{projectionView[0][1], projectionView[1][1], projectionView[2][1], projectionView[3][1]};
+        glm::vec4 row2{projectionView[0][2], projectionView[1][2], projectionView[2][2], projectionView[3][2]};
+        glm::vec4 row3{projectionView[0][3], projectionView[1][3], projectionView[2][3], projectionView[3][3]};
+
+        planes[0] = row3 + row0;
+        planes[1] = row3 - row0;
+        planes[2] = row3 + row1;
+        planes[3] = row3 - row1;
+        planes[4] = row2; // 0 <= z
+        planes[5] = row3 - row2;
+        for (auto &plane : planes) {
+            plane /= glm::length(glm::vec3(plane));
+        }
+    }
+
+    bool ZeFrustum::intersectsSphere(const glm::vec3 &center, float radius) const {
+        for (const auto &plane : planes) {
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ZeFrustum::intersectsBox(const glm::vec3 &min, const glm::vec3 &max) const {
+        for (const auto &plane : planes) {
+            // corner the furthest along the plane normal
+            glm::vec3 positive{
+                plane.x >= 0.0f ? max.x : min.x,
+                plane.y >= 0.0f ? max.y : min.y,
+                plane.z >= 0.0f ? max.z : min.z};
+            if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint32_t ZeFrustum::intersectSpheres(const glm::vec4 *spheres, uint32_t count, uint8_t *visible) const {
+        uint32_t visibleCount = 0;
+        uint32_t i = 0;
+#ifdef ZE_SIMD_SSE
+        // four spheres per iteration, transposed to one register per component
+        for (; i + 4 <= count; i += 4) {
+            __m128 x = _mm_loadu_ps(&spheres[i].x);
+            __m128 y = _mm_loadu_ps(&spheres[i + 1].x);
+            __m128 z = _mm_loadu_ps(&spheres[i + 2].x);
+            __m128 r = _mm_loadu_ps(&spheres[i + 3].x);
+            _MM_TRANSPOSE4_PS(x, y, z, r);
+            __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), r);
+
+            __m128 outside = _mm_setzero_ps();
+            for (const auto &plane : planes) {
+                __m128 distance = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                        _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+            }
+
+            int mask = _mm_movemask_ps(outside);
+            for (uint32_t lane = 0; lane < 4; lane++) {
+                uint8_t inside = (mask & (1 << lane)) == 0 ? 1 : 0;
+                visible[i + lane] = inside;
+                visibleCount += inside;
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            uint8_t inside = intersectsSphere(glm::vec3(spheres[i]), spheres[i].w) ? 1 : 0;
+            visible[i] = inside;
+            visibleCount += inside;
+        }
+        return visibleCount;
+    }
+
+}
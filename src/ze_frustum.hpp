@@ -0,0 +1,32 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+namespace ze {
+
+    // View frustum as 6 inward facing planes (left, right, bottom, top, near, far), extracted
+    // from a projection * view matrix with a 0..1 depth range
+    class ZeFrustum {
+    public:
+        ZeFrustum() = default;
+        explicit ZeFrustum(const glm::mat4 &projectionView);
+
+        // plane is (normal, distance) : dot(normal, p) + distance >= 0 inside
+        const glm::vec4 &getPlane(int index) const { return planes[index]; }
+
+        bool intersectsSphere(const glm::vec3 &center, float radius) const;
+        bool intersectsBox(const glm::vec3 &min, const glm::vec3 &max) const;
+
+        // tests spheres packed as (center, radius), visible[i] is set to 1 if the sphere
+        // intersects the frustum, 0 otherwise ; returns the number of visible spheres
+        uint32_t intersectSpheres(const glm::vec4 *spheres, uint32_t count, uint8_t *visible) const;
+
+    private:
+        glm::vec4 planes[6]{};
+    };
+
+}
@@ -1,22 +1,44 @@
 #pragma once
 
 #include "ze_model.hpp"
+#include "ze_transform_store.hpp"
 
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <memory>
 
 namespace ze {
-    struct TransformComponent {
-        glm::vec3 translation{};
-        glm::vec3 scale{1.0f, 1.0f, 1.0f };
-        glm::vec3 rotation{};
-
-        // Matrix corrsponds to Translate * Ry * Rx * Rz * Scale
-        // Rotations correspond to Tait-bryan angles of Y(1), X(2), Z(3)
-        // https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix
-        glm::mat4 mat4();
-        glm::mat3 normalMatrix();
+    // Handle on the transform of a game object in a ZeTransformStore, owns the store entry
+    class TransformComponent {
+    public:
+        TransformComponent(ZeTransformStore &store, ZeTransformStore::id_t id);
+        ~TransformComponent();
+
+        TransformComponent(const TransformComponent &) = delete;
+        TransformComponent &operator=(const TransformComponent &) = delete;
+        TransformComponent(TransformComponent &&other) noexcept;
+        TransformComponent &operator=(TransformComponent &&) = delete;
+
+        // the non const accessors mark the transform dirty, read through a const reference
+        glm::vec3 &translation() { return store->translation(id); }
+        glm::vec3 &rotation() { return store->rotation(id); }
+        glm::vec3 &scale() { return store->scale(id); }
+        const glm::vec3 &translation() const { return static_cast<const ZeTransformStore *>(store)->translation(id); }
+        const glm::vec3 &rotation() const { return static_cast<const ZeTransformStore *>(store)->rotation(id); }
+        const glm::vec3 &scale() const { return static_cast<const ZeTransformStore *>(store)->scale(id); }
+
+        // makes this transform relative to the parent one, nullptr to detach
+        void setParent(const TransformComponent *parent) {
+            store->setParent(id, parent == nullptr ? ZeTransformStore::NO_PARENT : parent->id);
+        }
+
+        // computed by ZeTransformStore::updateMatrices(), see there for the conventions
+        const glm::mat4 &mat4() const { return store->modelMatrix(id); }
+        const glm::mat4 &normalMatrix() const { return store->normalMatrix(id); }
+
+    private:
+        ZeTransformStore *store;
+        ZeTransformStore::id_t id;
     };
 
     struct PointLightComponent {
@@ -28,18 +50,19 @@ namespace ze {
         using id_t = unsigned int;
         using Map = std::unordered_map<id_t, ZeGameObject>;
 
-        static ZeGameObject createGameObject() {
+        static ZeGameObject createGameObject(ZeTransformStore &transforms) {
             static id_t currentId = 0;
-            return ZeGameObject{currentId++};
+            return ZeGameObject{currentId++, transforms};
         }
 
         static ZeGameObject makePointLight(
+                ZeTransformStore &transforms,
                 float intensity = 10.0f,
                 float radius = 0.1f,
                 glm::vec3 color = glm::vec3(1.0f)
                 );
 
-        id_t getId() { return id; }
+        id_t getId() const { return id; }
 
         ZeGameObject(const ZeGameObject &) = delete;
         ZeGameObject& operator=(const ZeGameObject &) = delete;
@@ -47,7 +70,7 @@ namespace ze {
         ZeGameObject &operator=(ZeGameObject &&) = delete;
 
         glm::vec3 color{};
-        TransformComponent transform{};
+        TransformComponent transform;
 
         // optional pointer components
         std::shared_ptr<ZeModel> model{};
@@ -56,7 +79,7 @@ namespace ze {
     private:
         id_t id;
 
-        explicit ZeGameObject(id_t objId): id{objId} {};
+        ZeGameObject(id_t objId, ZeTransformStore &transforms): transform{transforms, objId}, id{objId} {};
 
     };
 }
\ No newline at end of file
@@ -0,0 +1,141 @@
+#include "ze_gpu_profiler.hpp"
+#include "ze_utils.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace ze {
+
+    ZeGpuProfiler::ZeGpuProfiler(ZeDevice &device, uint32_t frameCount): zeDevice{device}, frames(frameCount) {
+        supported = device.properties.limits.timestampComputeAndGraphics == VK_TRUE;
+        // nanoseconds per tick
+        timestampPeriod = static_cast<double>(device.properties.limits.timestampPeriod);
+        if (!supported) {
+            return;
+        }
+
+        VkQueryPoolCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        createInfo.queryCount = 2 * MAX_SCOPES;
+        for (auto &frame : frames) {
+            if (vkCreateQueryPool(zeDevice.device(), &createInfo, nullptr, &frame.queryPool) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create timestamp query pool");
+            }
+            frame.names.reserve(MAX_SCOPES);
+            frame.ended.reserve(MAX_SCOPES);
+        }
+    }
+
+    ZeGpuProfiler::~ZeGpuProfiler() {
+        for (auto &frame : frames) {
+            if (frame.queryPool != VK_NULL_HANDLE) {
+                vkDestroyQueryPool(zeDevice.device(), frame.queryPool, nullptr);
+            }
+        }
+    }
+
+    void ZeGpuProfiler::beginFrame(VkCommandBuffer commandBuffer, int frameIndex) {
+        if (!supported) {
+            return;
+        }
+        currentFrame = &frames[frameIndex];
+        collect(*currentFrame);
+        vkCmdResetQueryPool(commandBuffer, currentFrame->queryPool, 0, 2 * MAX_SCOPES);
+    }
+
+    uint32_t ZeGpuProfiler::beginScope(VkCommandBuffer commandBuffer, const char *name) {
+        if (!supported || scopesSuspended || currentFrame == nullptr || currentFrame->names.size() == MAX_SCOPES) {
+            return INVALID_SCOPE;
+        }
+        auto scope = static_cast<uint32_t>(currentFrame->names.size());
+        currentFrame->names.push_back(name);
+        currentFrame->ended.push_back(false);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, currentFrame->queryPool, 2 * scope);
+        return scope;
+    }
+
+    void ZeGpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+        if (scope == INVALID_SCOPE) {
+            return;
+        }
+        assert(!currentFrame->ended[scope] && "GPU profiler scope ended twice");
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, currentFrame->queryPool, 2 * scope + 1);
+        currentFrame->ended[scope] = true;
+    }
+
+    void ZeGpuProfiler::collect(FrameQueries &frame) {
+        // scopes left open have no end timestamp, waiting on them would never return
+        for (uint32_t scope = 0; scope < frame.names.size(); scope++) {
+            if (!frame.ended[scope]) continue;
+            uint64_t timestamps[2];
+            if (vkGetQueryPoolResults(zeDevice.device(), frame.queryPool, 2 * scope, 2,
+                                      sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+                throw std::runtime_error("failed to read timestamp queries");
+            }
+
+            double ms = static_cast<double>(timestamps[1] - timestamps[0]) * timestampPeriod / 1.0e6;
+            auto &scopeHistory = history(frame.names[scope]);
+            if (scopeHistory.count == AVERAGE_FRAME_COUNT) {
+                scopeHistory.sum -= scopeHistory.samples[scopeHistory.next];
+            } else {
+                scopeHistory.count++;
+            }
+            scopeHistory.samples[scopeHistory.next] = ms;
+            scopeHistory.sum += ms;
+            scopeHistory.next = (scopeHistory.next + 1) % AVERAGE_FRAME_COUNT;
+
+            if (traceEnabled) {
+                traceEvents.push_back({frame.names[scope], timestamps[0], timestamps[1]});
+            }
+        }
+        frame.names.clear();
+        frame.ended.clear();
+    }
+
+    ZeGpuProfiler::ScopeHistory &ZeGpuProfiler::history(const char *name) {
+        for (auto &scopeHistory : histories) {
+            if (scopeHistory.name == name || std::strcmp(scopeHistory.name, name) == 0) {
+                return scopeHistory;
+            }
+        }
+        histories.push_back(ScopeHistory{name});
+        return histories.back();
+    }
+
+    std::vector<ZeGpuProfiler::ScopeStats> ZeGpuProfiler::getStats() const {
+        std::vector<ScopeStats> stats;
+        stats.reserve(histories.size());
+        for (const auto &scopeHistory : histories) {
+            uint32_t last = (scopeHistory.next + AVERAGE_FRAME_COUNT - 1) % AVERAGE_FRAME_COUNT;
+            stats.push_back({
+                scopeHistory.name,
+                scopeHistory.samples[last],
+                scopeHistory.sum / static_cast<double>(scopeHistory.count)});
+        }
+        return stats;
+    }
+
+    void ZeGpuProfiler::writeChromeTrace(std::ostream &out) const {
+        uint64_t origin = UINT64_MAX;
+        for (const auto &event : traceEvents) {
+            origin = std::min(origin, event.begin);
+        }
+
+        // timestamps are in ticks, trace events in microseconds
+        const double ticksToUs = timestampPeriod / 1.0e3;
+        out << "{\"traceEvents\":[\n";
+        for (size_t i = 0; i < traceEvents.size(); i++) {
+            const auto &event = traceEvents[i];
+            out << "{\"name\":" << jsonString(event.name) << ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":0"
+                << ",\"ts\":" << static_cast<double>(event.begin - origin) * ticksToUs
+                << ",\"dur\":" << static_cast<double>(event.end - event.begin) * ticksToUs << "}"
+                << (i + 1 < traceEvents.size() ? ",\n" : "\n");
+        }
+        out << "]}\n";
+    }
+
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "ze_device.hpp"
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace ze {
+
+    // GPU durations of named scopes of the frame command buffer, measured with timestamp queries.
+    // Each frame in flight has its own query pool, read back when the frame comes around again :
+    // previous use has completed by then, so reading never stalls. Durations are averaged over the
+    // last AVERAGE_FRAME_COUNT frames. All the calls are no-ops when the device has no timestamps.
+    class ZeGpuProfiler {
+    public:
+        static constexpr uint32_t MAX_SCOPES = 64;
+        static constexpr uint32_t AVERAGE_FRAME_COUNT = 60;
+        static constexpr uint32_t INVALID_SCOPE = UINT32_MAX;
+
+        struct ScopeStats {
+            const char *name;
+            double lastMs;
+            double averageMs;
+        };
+
+        // begins a scope on construction and ends it on destruction
+        class Scope {
+        public:
+            Scope(ZeGpuProfiler &profiler, VkCommandBuffer commandBuffer, const char *name):
+                    profiler{profiler}, commandBuffer{commandBuffer},
+                    scope{profiler.beginScope(commandBuffer, name)} {}
+            ~Scope() { profiler.endScope(commandBuffer, scope); }
+
+            Scope(const Scope &) = delete;
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            ZeGpuProfiler &profiler;
+            VkCommandBuffer commandBuffer;
+            uint32_t scope;
+        };
+
+        ZeGpuProfiler(ZeDevice &device, uint32_t frameCount);
+        ~ZeGpuProfiler();
+
+        ZeGpuProfiler(const ZeGpuProfiler &) = delete;
+        ZeGpuProfiler &operator=(const ZeGpuProfiler &) = delete;
+
+        bool isSupported() const { return supported; }
+
+        // call once the frame has been started, before any scope and outside a render pass :
+        // collects the previous results of this frame in flight and resets its queries
+        void beginFrame(VkCommandBuffer commandBuffer, int frameIndex);
+
+        // name must outlive the profiler (a string literal), scopes with the same name are
+        // averaged together, scopes beyond MAX_SCOPES in a frame are ignored
+        uint32_t beginScope(VkCommandBuffer commandBuffer, const char *name);
+        void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+        // while suspended beginScope() returns INVALID_SCOPE, for render passes recorded in
+        // secondary buffers where the primary buffer can not write timestamps
+        void setScopesSuspended(bool suspended) { scopesSuspended = suspended; }
+
+        // in order of first appearance
+        std::vector<ScopeStats> getStats() const;
+
+        // keeps every collected scope until writeChromeTrace(), off by default
+        void setTraceEnabled(bool enabled) { traceEnabled = enabled; }
+        // chrome://tracing JSON, one complete event per collected scope
+        void writeChromeTrace(std::ostream &out) const;
+
+    private:
+        struct FrameQueries {
+            VkQueryPool queryPool = VK_NULL_HANDLE;
+            std::vector<const char *> names;
+            std::vector<uint8_t> ended;
+        };
+
+        struct ScopeHistory {
+            const char *name;
+            std::array<double, AVERAGE_FRAME_COUNT> samples{};
+            uint32_t count = 0;
+            uint32_t next = 0;
+            double sum = 0.0;
+        };
+
+        struct TraceEvent {
+            const char *name;
+            uint64_t begin;
+            uint64_t end;
+        };
+
+        void collect(FrameQueries &frame);
+        ScopeHistory &history(const char *name);
+
+        ZeDevice &zeDevice;
+        bool supported;
+        double timestampPeriod;
+
+        std::vector<FrameQueries> frames;
+        FrameQueries *currentFrame = nullptr;
+        bool scopesSuspended{false};
+        std::vector<ScopeHistory> histories;
+
+        bool traceEnabled{false};
+        std::vector<TraceEvent> traceEvents;
+    };
+
+}
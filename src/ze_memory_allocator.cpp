@@ -0,0 +1,359 @@
+#include "ze_memory_allocator.hpp"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace ze {
+
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment) {
+        return value / alignment * alignment;
+    }
+
+    struct ZeMemoryBlock {
+        struct Range {
+            VkDeviceSize offset;
+            VkDeviceSize size;
+        };
+
+        struct Allocated {
+            VkDeviceSize size;
+            VkDeviceSize alignment;
+        };
+
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        VkDeviceSize size{0};
+        void *mapped{nullptr};
+        uint32_t memoryTypeIndex{0};
+        bool dedicated{false};
+
+        std::vector<Range> freeRanges; // sorted by offset, never adjacent
+        std::map<VkDeviceSize, Allocated> allocations;
+        VkDeviceSize usedBytes{0};
+
+        bool tryAllocate(VkDeviceSize allocationSize, VkDeviceSize alignment, VkDeviceSize &offset) {
+            for (size_t i = 0; i < freeRanges.size(); i++) {
+                Range range = freeRanges[i];
+                VkDeviceSize aligned = alignUp(range.offset, alignment);
+                if (aligned + allocationSize > range.offset + range.size) {
+                    continue;
+                }
+                // keep the alignment padding and the remainder as free ranges
+                Range head{range.offset, aligned - range.offset};
+                Range tail{aligned + allocationSize, range.offset + range.size - aligned - allocationSize};
+                freeRanges.erase(freeRanges.begin() + i);
+                if (tail.size > 0) freeRanges.insert(freeRanges.begin() + i, tail);
+                if (head.size > 0) freeRanges.insert(freeRanges.begin() + i, head);
+
+                allocations[aligned] = {allocationSize, alignment};
+                usedBytes += allocationSize;
+                offset = aligned;
+                return true;
+            }
+            return false;
+        }
+
+        void release(VkDeviceSize offset) {
+            auto it = allocations.find(offset);
+            if (it == allocations.end()) {
+                throw std::runtime_error("freeing an unknown allocation");
+            }
+            Range range{offset, it->second.size};
+            usedBytes -= it->second.size;
+            allocations.erase(it);
+
+            auto next = std::lower_bound(freeRanges.begin(), freeRanges.end(), range.offset,
+                                         [](const Range &r, VkDeviceSize o) { return r.offset < o; });
+            if (next != freeRanges.end() && range.offset + range.size == next->offset) {
+                range.size += next->size;
+                next = freeRanges.erase(next);
+            }
+            if (next != freeRanges.begin()) {
+                auto previous = next - 1;
+                if (previous->offset + previous->size == range.offset) {
+                    previous->size += range.size;
+                    return;
+                }
+            }
+            freeRanges.insert(next, range);
+        }
+
+        bool isEmpty() const { return allocations.empty(); }
+
+        VkDeviceSize largestFreeRange() const {
+            VkDeviceSize largest = 0;
+            for (const auto &range : freeRanges) largest = std::max(largest, range.size);
+            return largest;
+        }
+    };
+
+    ZeMemoryAllocator::ZeMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize)
+            : device{device}, blockSize{blockSize} {
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        nonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+        maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+        pools.resize(memoryProperties.memoryTypeCount * 2);
+    }
+
+    ZeMemoryAllocator::~ZeMemoryAllocator() {
+        for (auto &pool : pools) {
+            for (auto &block : pool.blocks) destroyBlock(block.get());
+        }
+        for (auto &block : dedicatedBlocks) destroyBlock(block.get());
+    }
+
+    uint32_t ZeMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) &&
+                (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    std::unique_ptr<ZeMemoryBlock> ZeMemoryAllocator::createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated) {
+        if (liveDeviceMemoryCount >= maxMemoryAllocationCount) {
+            throw std::runtime_error("maxMemoryAllocationCount reached");
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+        auto block = std::make_unique<ZeMemoryBlock>();
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate device memory block!");
+        }
+        liveDeviceMemoryCount++;
+        deviceMemoryAllocations++;
+
+        block->size = size;
+        block->memoryTypeIndex = memoryTypeIndex;
+        block->dedicated = dedicated;
+        block->freeRanges.push_back({0, size});
+        if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            // host visible blocks stay mapped : a memory object can only be mapped once
+            if (vkMapMemory(device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+                vkFreeMemory(device, block->memory, nullptr);
+                liveDeviceMemoryCount--;
+                throw std::runtime_error("failed to map device memory block!");
+            }
+        }
+
+        return block;
+    }
+
+    void ZeMemoryAllocator::destroyBlock(ZeMemoryBlock *block) {
+        if (block->mapped != nullptr) {
+            vkUnmapMemory(device, block->memory);
+        }
+        vkFreeMemory(device, block->memory, nullptr);
+        liveDeviceMemoryCount--;
+    }
+
+    ZeAllocation ZeMemoryAllocator::allocate(const VkMemoryRequirements &requirements,
+                                             VkMemoryPropertyFlags properties, bool linear) {
+        std::lock_guard<std::mutex> lock{mutex};
+        uint32_t memoryTypeIndex = findMemoryType(requirements.memoryTypeBits, properties);
+        VkMemoryPropertyFlags typeFlags = memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags;
+
+        VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+        VkDeviceSize size = requirements.size;
+        if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+            // flush and invalidate ranges are atom aligned, they must not overlap a neighbor
+            alignment = std::max(alignment, nonCoherentAtomSize);
+            size = alignUp(size, nonCoherentAtomSize);
+        }
+
+        // small heaps (integrated or BAR memory) get smaller blocks
+        VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryTypeIndex].heapIndex].size;
+        VkDeviceSize typeBlockSize = std::min(blockSize, alignUp(heapSize / 8, nonCoherentAtomSize));
+
+        ZeMemoryBlock *block = nullptr;
+        VkDeviceSize offset = 0;
+        if (size > typeBlockSize / 2) {
+            dedicatedBlocks.push_back(createBlock(memoryTypeIndex, size, true));
+            block = dedicatedBlocks.back().get();
+            block->tryAllocate(size, alignment, offset);
+        } else {
+            Pool &pool = poolFor(memoryTypeIndex, linear);
+            for (auto &candidate : pool.blocks) {
+                if (candidate->tryAllocate(size, alignment, offset)) {
+                    block = candidate.get();
+                    break;
+                }
+            }
+            if (block == nullptr) {
+                pool.blocks.push_back(createBlock(memoryTypeIndex, typeBlockSize, false));
+                block = pool.blocks.back().get();
+                block->tryAllocate(size, alignment, offset);
+            }
+        }
+
+        ZeAllocation allocation{};
+        allocation.memory = block->memory;
+        allocation.offset = offset;
+        allocation.size = size;
+        allocation.mapped = block->mapped != nullptr ? static_cast<char *>(block->mapped) + offset : nullptr;
+        allocation.memoryTypeIndex = memoryTypeIndex;
+        allocation.block = block;
+        return allocation;
+    }
+
+    void ZeMemoryAllocator::free(const ZeAllocation &allocation) {
+        if (allocation.block == nullptr) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock{mutex};
+        ZeMemoryBlock *block = allocation.block;
+        block->release(allocation.offset);
+        if (!block->isEmpty()) {
+            return;
+        }
+
+        if (block->dedicated) {
+            auto it = std::find_if(dedicatedBlocks.begin(), dedicatedBlocks.end(),
+                                   [block](const std::unique_ptr<ZeMemoryBlock> &b) { return b.get() == block; });
+            destroyBlock(block);
+            dedicatedBlocks.erase(it);
+            return;
+        }
+
+        // keep a single empty block per pool to absorb allocate/free churn
+        for (auto &pool : pools) {
+            auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                                   [block](const std::unique_ptr<ZeMemoryBlock> &b) { return b.get() == block; });
+            if (it == pool.blocks.end()) continue;
+            bool otherEmpty = std::any_of(pool.blocks.begin(), pool.blocks.end(), [block](const std::unique_ptr<ZeMemoryBlock> &b) {
+                return b.get() != block && b->isEmpty();
+            });
+            if (otherEmpty) {
+                destroyBlock(block);
+                pool.blocks.erase(it);
+            }
+            return;
+        }
+    }
+
+    VkMappedMemoryRange ZeMemoryAllocator::mappedRange(const ZeAllocation &allocation, VkDeviceSize size, VkDeviceSize offset) const {
+        VkDeviceSize begin = allocation.offset + offset;
+        VkDeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+        begin = alignDown(begin, nonCoherentAtomSize);
+        end = std::min(alignUp(end, nonCoherentAtomSize), allocation.block->size);
+
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = allocation.memory;
+        range.offset = begin;
+        range.size = end == allocation.block->size ? VK_WHOLE_SIZE : end - begin;
+        return range;
+    }
+
+    VkResult ZeMemoryAllocator::flush(const ZeAllocation &allocation, VkDeviceSize size, VkDeviceSize offset) {
+        VkMappedMemoryRange range = mappedRange(allocation, size, offset);
+        return vkFlushMappedMemoryRanges(device, 1, &range);
+    }
+
+    VkResult ZeMemoryAllocator::invalidate(const ZeAllocation &allocation, VkDeviceSize size, VkDeviceSize offset) {
+        VkMappedMemoryRange range = mappedRange(allocation, size, offset);
+        return vkInvalidateMappedMemoryRanges(device, 1, &range);
+    }
+
+    void ZeMemoryAllocator::trim() {
+        std::lock_guard<std::mutex> lock{mutex};
+        for (auto &pool : pools) {
+            for (auto it = pool.blocks.begin(); it != pool.blocks.end();) {
+                if ((*it)->isEmpty()) {
+                    destroyBlock(it->get());
+                    it = pool.blocks.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    uint32_t ZeMemoryAllocator::defragment(const MoveCallback &move) {
+        struct Move {
+            ZeAllocation from;
+            ZeAllocation to;
+        };
+        // the target ranges are reserved under the lock, then the callbacks run unlocked
+        std::vector<Move> moves;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            for (auto &pool : pools) {
+                for (size_t source = pool.blocks.size(); source-- > 1;) {
+                    ZeMemoryBlock *from = pool.blocks[source].get();
+                    for (const auto &kv : from->allocations) {
+                        for (size_t target = 0; target < source; target++) {
+                            ZeMemoryBlock *to = pool.blocks[target].get();
+                            VkDeviceSize offset;
+                            if (!to->tryAllocate(kv.second.size, kv.second.alignment, offset)) continue;
+
+                            ZeAllocation fromAllocation{from->memory, kv.first, kv.second.size,
+                                    from->mapped ? static_cast<char *>(from->mapped) + kv.first : nullptr,
+                                    from->memoryTypeIndex, from};
+                            ZeAllocation toAllocation{to->memory, offset, kv.second.size,
+                                    to->mapped ? static_cast<char *>(to->mapped) + offset : nullptr,
+                                    to->memoryTypeIndex, to};
+                            moves.push_back({fromAllocation, toAllocation});
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<bool> accepted(moves.size());
+        for (size_t i = 0; i < moves.size(); i++) {
+            accepted[i] = move(moves[i].from, moves[i].to);
+        }
+
+        uint32_t moved = 0;
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            for (size_t i = 0; i < moves.size(); i++) {
+                if (accepted[i]) {
+                    moves[i].from.block->release(moves[i].from.offset);
+                    moved++;
+                } else {
+                    moves[i].to.block->release(moves[i].to.offset);
+                }
+            }
+        }
+        trim();
+        return moved;
+    }
+
+    ZeMemoryAllocator::Stats ZeMemoryAllocator::getStats() const {
+        std::lock_guard<std::mutex> lock{mutex};
+        Stats stats{};
+        stats.deviceMemoryAllocations = deviceMemoryAllocations;
+        VkDeviceSize freeBytes = 0;
+        VkDeviceSize largestFreeBytes = 0;
+        auto addBlock = [&](const ZeMemoryBlock &block) {
+            stats.blockCount++;
+            stats.allocationCount += static_cast<uint32_t>(block.allocations.size());
+            stats.reservedBytes += block.size;
+            stats.usedBytes += block.usedBytes;
+            freeBytes += block.size - block.usedBytes;
+            largestFreeBytes += block.largestFreeRange();
+        };
+        for (const auto &pool : pools) {
+            for (const auto &block : pool.blocks) addBlock(*block);
+        }
+        for (const auto &block : dedicatedBlocks) addBlock(*block);
+        stats.fragmentation = freeBytes > 0 ? 1.0f - static_cast<float>(largestFreeBytes) / static_cast<float>(freeBytes) : 0.0f;
+        return stats;
+    }
+
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ze {
+
+    struct ZeMemoryBlock;
+
+    // A range of a device memory block, bind resources with memory + offset
+    struct ZeAllocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void *mapped = nullptr; // persistently mapped address of the range, for host visible memory
+        uint32_t memoryTypeIndex = 0;
+        ZeMemoryBlock *block = nullptr;
+    };
+
+    // Sub-allocates resources from large device memory blocks (one list of blocks per memory type,
+    // first-fit free list inside each block) to stay far below maxMemoryAllocationCount.
+    class ZeMemoryAllocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+        struct Stats {
+            uint32_t blockCount;
+            uint32_t allocationCount;
+            uint32_t deviceMemoryAllocations; // vkAllocateMemory calls since creation
+            VkDeviceSize reservedBytes;
+            VkDeviceSize usedBytes;
+            // 0 when the free space of each block is a single range, towards 1 when it is
+            // scattered in many small ranges
+            float fragmentation;
+        };
+
+        // called with the old and new range of a moved allocation, the owner copies the data and
+        // rebinds its resource ; returning false keeps the allocation where it was. Called without
+        // the allocator lock, it can allocate and free (a new resource bound to the new range)
+        using MoveCallback = std::function<bool(const ZeAllocation &from, const ZeAllocation &to)>;
+
+        ZeMemoryAllocator(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+        ~ZeMemoryAllocator();
+
+        ZeMemoryAllocator(const ZeMemoryAllocator&) = delete;
+        ZeMemoryAllocator &operator=(const ZeMemoryAllocator&) = delete;
+
+        // linear is true for buffers and linear images, false for optimal tiling images : they
+        // are kept in separate blocks to honor bufferImageGranularity
+        ZeAllocation allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags properties, bool linear);
+        void free(const ZeAllocation &allocation);
+
+        // for non coherent memory, the range is expanded to nonCoherentAtomSize
+        VkResult flush(const ZeAllocation &allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+        VkResult invalidate(const ZeAllocation &allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
+        // releases the blocks without any allocation
+        void trim();
+        // moves allocations out of the last blocks of each memory type into free ranges of the
+        // first ones, then trims, returns the number of moved allocations. The moved allocations
+        // must not be freed by other threads while it runs
+        uint32_t defragment(const MoveCallback &move);
+
+        Stats getStats() const;
+
+    private:
+        struct Pool {
+            std::vector<std::unique_ptr<ZeMemoryBlock>> blocks;
+        };
+
+        uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        std::unique_ptr<ZeMemoryBlock> createBlock(uint32_t memoryTypeIndex, VkDeviceSize size, bool dedicated);
+        void destroyBlock(ZeMemoryBlock *block);
+        VkMappedMemoryRange mappedRange(const ZeAllocation &allocation, VkDeviceSize size, VkDeviceSize offset) const;
+        Pool &poolFor(uint32_t memoryTypeIndex, bool linear) { return pools[memoryTypeIndex * 2 + (linear ? 0 : 1)]; }
+
+        VkDevice device;
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        VkDeviceSize nonCoherentAtomSize;
+        uint32_t maxMemoryAllocationCount;
+        VkDeviceSize blockSize;
+
+        mutable std::mutex mutex;
+        std::vector<Pool> pools;
+        std::vector<std::unique_ptr<ZeMemoryBlock>> dedicatedBlocks;
+        uint32_t liveDeviceMemoryCount{0};
+        uint32_t deviceMemoryAllocations{0};
+    };
+
+}
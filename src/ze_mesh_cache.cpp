@@ -0,0 +1,211 @@
+#include "ze_mesh_cache.hpp"
+#include "ze_utils.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace ze {
+
+    static_assert(sizeof(ZeMeshCache::Header) == 64, "mesh cache header must stay packed");
+
+    static constexpr char MESH_CACHE_MAGIC[4] = {'Z', 'M', 'S', 'H'};
+
+    static bool sourceInfo(const std::string &filepath, int64_t &time, uint64_t &size) {
+        std::error_code error;
+        auto lastWrite = std::filesystem::last_write_time(filepath, error);
+        if (error) return false;
+        auto fileSize = std::filesystem::file_size(filepath, error);
+        if (error) return false;
+        time = static_cast<int64_t>(lastWrite.time_since_epoch().count());
+        size = static_cast<uint64_t>(fileSize);
+        return true;
+    }
+
+    ZeMeshCache::~ZeMeshCache() {
+        unmap();
+    }
+
+    std::string ZeMeshCache::cachePathFor(const std::string &filepath) {
+        return filepath + ".zmesh";
+    }
+
+    std::unique_ptr<ZeMeshCache> ZeMeshCache::open(const std::string &filepath) {
+        int64_t sourceTime;
+        uint64_t sourceSize;
+        if (!sourceInfo(filepath, sourceTime, sourceSize)) {
+            return nullptr;
+        }
+
+        std::unique_ptr<ZeMeshCache> cache{new ZeMeshCache()};
+        if (!cache->map(cachePathFor(filepath))) {
+            return nullptr;
+        }
+
+        const Header &header = *cache->header;
+        size_t expectedSize = sizeof(Header) +
+                sizeof(ZeModel::Vertex) * static_cast<size_t>(header.vertexCount) +
+                sizeof(uint32_t) * static_cast<size_t>(header.indexCount);
+        if (std::memcmp(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 ||
+            header.version != VERSION ||
+            header.vertexSize != sizeof(ZeModel::Vertex) ||
+            header.sourceTime != sourceTime ||
+            header.sourceSize != sourceSize ||
+            cache->mappedSize != expectedSize) {
+            return nullptr;
+        }
+        return cache;
+    }
+
+    bool ZeMeshCache::write(const std::string &filepath, const ZeModel::Builder &builder) {
+        Header header{};
+        std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+        header.version = VERSION;
+        header.vertexSize = sizeof(ZeModel::Vertex);
+        header.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+        header.indexCount = static_cast<uint32_t>(builder.indices.size());
+        if (!sourceInfo(filepath, header.sourceTime, header.sourceSize)) {
+            return false;
+        }
+
+        header.boundsMin = builder.bounds.min;
+        header.boundsMax = builder.bounds.max;
+        header.boundsRadius = builder.bounds.radius;
+
+        // write to a temporary file first so a concurrent reader never maps a partial cache
+        const std::string cachePath = cachePathFor(filepath);
+        const std::string tmpPath = uniqueTemporaryPath(cachePath);
+        {
+            std::ofstream file{tmpPath, std::ios::binary | std::ios::trunc};
+            if (!file.is_open()) {
+                return false;
+            }
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char *>(builder.vertices.data()),
+                       static_cast<std::streamsize>(sizeof(ZeModel::Vertex) * builder.vertices.size()));
+            file.write(reinterpret_cast<const char *>(builder.indices.data()),
+                       static_cast<std::streamsize>(sizeof(uint32_t) * builder.indices.size()));
+            // close() flushes : a short write (disk full) only shows after it
+            file.close();
+            if (!file.good()) {
+                std::error_code error;
+                std::filesystem::remove(tmpPath, error);
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tmpPath, cachePath, error);
+        if (error) {
+            std::filesystem::remove(tmpPath, error);
+            return false;
+        }
+        return true;
+    }
+
+    ZeModel::Bounds ZeMeshCache::getBounds() const {
+        ZeModel::Bounds bounds{};
+        bounds.min = header->boundsMin;
+        bounds.max = header->boundsMax;
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+        bounds.radius = header->boundsRadius;
+        return bounds;
+    }
+
+    const ZeModel::Vertex* ZeMeshCache::getVertices() const {
+        return reinterpret_cast<const ZeModel::Vertex *>(mapped + sizeof(Header));
+    }
+
+    const uint32_t* ZeMeshCache::getIndices() const {
+        return reinterpret_cast<const uint32_t *>(
+                mapped + sizeof(Header) + sizeof(ZeModel::Vertex) * header->vertexCount);
+    }
+
+#ifdef _WIN32
+    bool ZeMeshCache::map(const std::string &cachePath) {
+        HANDLE file = CreateFileA(cachePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        fileHandle = file;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size) || static_cast<size_t>(size.QuadPart) < sizeof(Header)) {
+            return false;
+        }
+        mappedSize = static_cast<size_t>(size.QuadPart);
+
+        mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle == nullptr) {
+            return false;
+        }
+        mapped = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+        if (mapped == nullptr) {
+            return false;
+        }
+        header = reinterpret_cast<const Header *>(mapped);
+        return true;
+    }
+
+    void ZeMeshCache::unmap() {
+        if (mapped != nullptr) {
+            UnmapViewOfFile(mapped);
+            mapped = nullptr;
+        }
+        if (mappingHandle != nullptr) {
+            CloseHandle(mappingHandle);
+            mappingHandle = nullptr;
+        }
+        if (fileHandle != nullptr) {
+            CloseHandle(fileHandle);
+            fileHandle = nullptr;
+        }
+        header = nullptr;
+    }
+#else
+    bool ZeMeshCache::map(const std::string &cachePath) {
+        int fd = ::open(cachePath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header)) {
+            ::close(fd);
+            return false;
+        }
+        mappedSize = static_cast<size_t>(st.st_size);
+
+        void *address = mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        // the mapping stays valid once the descriptor is closed
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            return false;
+        }
+        mapped = static_cast<const char *>(address);
+        header = reinterpret_cast<const Header *>(mapped);
+        return true;
+    }
+
+    void ZeMeshCache::unmap() {
+        if (mapped != nullptr) {
+            munmap(const_cast<char *>(mapped), mappedSize);
+            mapped = nullptr;
+        }
+        header = nullptr;
+    }
+#endif
+
+}
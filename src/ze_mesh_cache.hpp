@@ -0,0 +1,62 @@
+#pragma once
+
+#include "ze_model.hpp"
+
+#include <memory>
+#include <string>
+
+namespace ze {
+
+    // Binary mesh cache written next to the source OBJ ("<file>.zmesh").
+    // Layout : Header | Vertex[vertexCount] | uint32_t[indexCount]
+    class ZeMeshCache {
+    public:
+        static constexpr uint32_t VERSION = 2;
+
+        struct Header {
+            char magic[4];
+            uint32_t version;
+            uint32_t vertexSize; // sizeof(ZeModel::Vertex) when written, guards layout changes
+            uint32_t vertexCount;
+            uint32_t indexCount;
+            float boundsRadius;
+            int64_t sourceTime; // last write time of the source file
+            uint64_t sourceSize;
+            glm::vec3 boundsMin;
+            glm::vec3 boundsMax;
+        };
+
+        ~ZeMeshCache();
+
+        ZeMeshCache(const ZeMeshCache&) = delete;
+        ZeMeshCache &operator=(const ZeMeshCache&) = delete;
+
+        static std::string cachePathFor(const std::string &filepath);
+
+        // returns nullptr if the cache is missing, invalid or older than the source file
+        static std::unique_ptr<ZeMeshCache> open(const std::string &filepath);
+        // returns false if the cache could not be written (read-only directory, ...)
+        static bool write(const std::string &filepath, const ZeModel::Builder &builder);
+
+        const ZeModel::Vertex* getVertices() const;
+        const uint32_t* getIndices() const;
+        uint32_t getVertexCount() const { return header->vertexCount; }
+        uint32_t getIndexCount() const { return header->indexCount; }
+        ZeModel::Bounds getBounds() const;
+
+    private:
+        ZeMeshCache() = default;
+
+        bool map(const std::string &cachePath);
+        void unmap();
+
+        const Header *header{nullptr};
+        const char *mapped{nullptr};
+        size_t mappedSize{0};
+#ifdef _WIN32
+        void *fileHandle{nullptr};
+        void *mappingHandle{nullptr};
+#endif
+    };
+
+}
@@ -0,0 +1,534 @@
+#include "ze_micro_benchmark.hpp"
+#include "ze_buffer.hpp"
+#include "ze_device.hpp"
+#include "ze_draw_list.hpp"
+#include "ze_model.hpp"
+#include "ze_simd.hpp"
+#include "ze_thread_pool.hpp"
+#include "ze_transform_math.hpp"
+#include "ze_transform_store.hpp"
+#include "ze_utils.hpp"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace ze {
+
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        double elapsedMs(Clock::time_point start, Clock::time_point end) {
+            return std::chrono::duration<double, std::milli>(end - start).count();
+        }
+
+        void writeAllocatorStats(std::ostream &out, const ZeMemoryAllocator::Stats &stats) {
+            out << "\"blocks\": " << stats.blockCount
+                << ", \"allocations\": " << stats.allocationCount
+                << ", \"reservedBytes\": " << stats.reservedBytes
+                << ", \"usedBytes\": " << stats.usedBytes
+                << ", \"fragmentation\": " << stats.fragmentation;
+        }
+    }
+
+    bool runTransformMathBenchmark(uint32_t count, std::ostream &out) {
+        // absolute, the matrices are built from unit vectors and scales in [0.25, 4]
+        static constexpr float TOLERANCE = 1.0e-5f;
+        struct AngleRange {
+            const char *name;
+            float center;
+            float spread;
+            // center is negated for half the angles
+            bool bothSigns;
+        };
+        const AngleRange ranges[] = {
+            {"uniform", 0.0f, glm::pi<float>(), false},
+            {"nearPi", glm::pi<float>(), 1.0e-3f, true},
+            {"large", 0.0f, 8192.0f, false},
+        };
+
+        count = std::max(count, 1u);
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> unit{-1.0f, 1.0f};
+        std::uniform_real_distribution<float> scaleValues{0.25f, 4.0f};
+        std::vector<glm::vec3> translations(count);
+        std::vector<glm::vec3> rotations(count);
+        std::vector<glm::vec3> scales(count);
+        std::vector<glm::mat4> models(count);
+        std::vector<glm::mat4> normals(count);
+        std::vector<glm::mat4> referenceModels(count);
+        std::vector<glm::mat4> referenceNormals(count);
+        for (uint32_t i = 0; i < count; i++) {
+            translations[i] = 100.0f * glm::vec3{unit(random), unit(random), unit(random)};
+            scales[i] = glm::vec3{scaleValues(random), scaleValues(random), scaleValues(random)};
+        }
+
+        auto maxError = [count](const std::vector<glm::mat4> &a, const std::vector<glm::mat4> &b) {
+            float error = 0.0f;
+            for (uint32_t i = 0; i < count; i++) {
+                for (int column = 0; column < 4; column++) {
+                    for (int row = 0; row < 4; row++) {
+                        error = std::max(error, std::abs(a[i][column][row] - b[i][column][row]));
+                    }
+                }
+            }
+            return error;
+        };
+
+        bool passed = true;
+        out << "{\n";
+        out << "  \"mode\": \"transform-math\",\n";
+#ifdef ZE_SIMD_SSE
+        out << "  \"simd\": \"sse2\",\n";
+#else
+        out << "  \"simd\": null,\n";
+#endif
+        out << "  \"count\": " << count << ",\n";
+        out << "  \"tolerance\": " << TOLERANCE << ",\n";
+        out << "  \"maxAbsoluteError\": {";
+        for (size_t r = 0; r < std::size(ranges); r++) {
+            const auto &range = ranges[r];
+            auto angle = [&]() {
+                float center = range.bothSigns && unit(random) < 0.0f ? -range.center : range.center;
+                return center + range.spread * unit(random);
+            };
+            for (auto &rotation : rotations) {
+                rotation = glm::vec3{angle(), angle(), angle()};
+            }
+            composeTransforms(translations.data(), rotations.data(), scales.data(), models.data(), normals.data(), count);
+            composeTransformsScalar(translations.data(), rotations.data(), scales.data(),
+                                    referenceModels.data(), referenceNormals.data(), count);
+            const float modelError = maxError(models, referenceModels);
+            const float normalError = maxError(normals, referenceNormals);
+            passed = passed && modelError <= TOLERANCE && normalError <= TOLERANCE;
+            out << (r == 0 ? "\n" : ",\n")
+                << "    \"" << range.name << "\": { \"model\": " << modelError << ", \"normal\": " << normalError << " }";
+        }
+        out << "\n  },\n";
+        out << "  \"passed\": " << (passed ? "true" : "false") << ",\n";
+
+        // about ten million transforms per kernel, best call of the iterations
+        const uint32_t iterations = std::max(10'000'000u / count, 3u);
+        auto time = [&](auto compose) {
+            double best = std::numeric_limits<double>::max();
+            for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+                const auto start = Clock::now();
+                compose(translations.data(), rotations.data(), scales.data(), models.data(), normals.data(), count);
+                best = std::min(best, elapsedMs(start, Clock::now()));
+            }
+            return best;
+        };
+        const double scalarMs = time(composeTransformsScalar);
+        const double batchMs = time(composeTransforms);
+        out << "  \"milliseconds\": { \"scalar\": " << scalarMs
+            << ", \"composeTransforms\": " << batchMs
+            << ", \"speedup\": " << scalarMs / batchMs << " }\n";
+        out << "}\n";
+        return passed;
+    }
+
+    bool runTransformStoreBenchmark(uint32_t count, std::ostream &out) {
+        // absolute, as transform-math : the store composes with the SIMD kernel
+        static constexpr float TOLERANCE = 1.0e-5f;
+        // the game objects before the store : the transform in the object, looked up by id
+        struct MapObject {
+            glm::vec3 color{};
+            glm::vec3 translation{};
+            glm::vec3 rotation{};
+            glm::vec3 scale{1.0f};
+            std::shared_ptr<int> model{};
+            glm::mat4 modelMatrix{1.0f};
+            glm::mat4 normalMatrix{1.0f};
+        };
+        count = std::max(count, 1u);
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> unit{-1.0f, 1.0f};
+        std::uniform_real_distribution<float> scaleValues{0.25f, 4.0f};
+        ZeTransformStore store{};
+        std::unordered_map<uint32_t, MapObject> objects;
+        for (ZeTransformStore::id_t id = 0; id < count; id++) {
+            MapObject object{};
+            object.translation = 100.0f * glm::vec3{unit(random), unit(random), unit(random)};
+            object.rotation = glm::pi<float>() * glm::vec3{unit(random), unit(random), unit(random)};
+            object.scale = glm::vec3{scaleValues(random), scaleValues(random), scaleValues(random)};
+            store.add(id);
+            store.translation(id) = object.translation;
+            store.rotation(id) = object.rotation;
+            store.scale(id) = object.scale;
+            objects.emplace(id, std::move(object));
+        }
+
+        // every transform changed in a frame : the whole store against every object of the map
+        auto updateMap = [&]() {
+            for (auto &kv : objects) {
+                auto &object = kv.second;
+                composeTransformsScalar(&object.translation, &object.rotation, &object.scale,
+                                        &object.modelMatrix, &object.normalMatrix, 1);
+            }
+        };
+        auto updateStore = [&]() {
+            for (ZeTransformStore::id_t id = 0; id < count; id++) {
+                store.translation(id);
+            }
+            store.updateMatrices();
+        };
+
+        updateMap();
+        updateStore();
+        float maxError = 0.0f;
+        for (const auto &kv : objects) {
+            for (int column = 0; column < 4; column++) {
+                for (int row = 0; row < 4; row++) {
+                    maxError = std::max(maxError, std::abs(store.modelMatrix(kv.first)[column][row] -
+                                                           kv.second.modelMatrix[column][row]));
+                    maxError = std::max(maxError, std::abs(store.normalMatrix(kv.first)[column][row] -
+                                                           kv.second.normalMatrix[column][row]));
+                }
+            }
+        }
+        const bool passed = maxError <= TOLERANCE;
+
+        // about ten million transforms per update, best call of the iterations
+        const uint32_t iterations = std::max(10'000'000u / count, 3u);
+        auto time = [&](auto update) {
+            double best = std::numeric_limits<double>::max();
+            for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+                const auto start = Clock::now();
+                update();
+                best = std::min(best, elapsedMs(start, Clock::now()));
+            }
+            return best;
+        };
+        const double mapMs = time(updateMap);
+        const double storeMs = time(updateStore);
+        // nothing dirty, the update returns right away
+        const double staticStoreMs = time([&]() { store.updateMatrices(); });
+
+        out << "{\n";
+        out << "  \"mode\": \"transform-store\",\n";
+        out << "  \"count\": " << count << ",\n";
+        out << "  \"maxAbsoluteError\": " << maxError << ",\n";
+        out << "  \"passed\": " << (passed ? "true" : "false") << ",\n";
+        out << "  \"milliseconds\": { \"map\": " << mapMs
+            << ", \"store\": " << storeMs
+            << ", \"staticStore\": " << staticStoreMs
+            << ", \"speedup\": " << mapMs / storeMs << " }\n";
+        out << "}\n";
+        return passed;
+    }
+
+    bool runTransformDirtyCheck(uint32_t count, std::ostream &out) {
+        // relative, the world matrices chain the local ones down the hierarchy
+        static constexpr float TOLERANCE = 1.0e-4f;
+        static constexpr uint32_t ROOT_COUNT = 8;
+        static constexpr uint32_t MOVE_COUNT = 16;
+        count = std::max(count, ROOT_COUNT + 1);
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> unit{-1.0f, 1.0f};
+        std::uniform_real_distribution<float> scaleValues{0.5f, 2.0f};
+
+        // a random forest : the parent of a transform is an earlier one, parents come first by id
+        ZeTransformStore store{};
+        std::vector<ZeTransformStore::id_t> parents(count, ZeTransformStore::NO_PARENT);
+        std::vector<std::vector<ZeTransformStore::id_t>> children(count);
+        for (ZeTransformStore::id_t id = 0; id < count; id++) {
+            store.add(id);
+            store.translation(id) = 10.0f * glm::vec3{unit(random), unit(random), unit(random)};
+            store.rotation(id) = glm::pi<float>() * glm::vec3{unit(random), unit(random), unit(random)};
+            store.scale(id) = glm::vec3{scaleValues(random), scaleValues(random), scaleValues(random)};
+            if (id >= ROOT_COUNT) {
+                parents[id] = std::uniform_int_distribution<ZeTransformStore::id_t>{0, id - 1}(random);
+                children[parents[id]].push_back(id);
+                store.setParent(id, parents[id]);
+            }
+        }
+        auto subtreeSize = [&](ZeTransformStore::id_t root) {
+            uint32_t size = 0;
+            std::vector<ZeTransformStore::id_t> stack{root};
+            while (!stack.empty()) {
+                auto id = stack.back();
+                stack.pop_back();
+                size++;
+                stack.insert(stack.end(), children[id].begin(), children[id].end());
+            }
+            return size;
+        };
+        // every world matrix composed from scratch, then compared with the cached ones
+        std::vector<glm::mat4> world(count);
+        auto matricesMatch = [&]() {
+            const ZeTransformStore &view = store;
+            for (ZeTransformStore::id_t id = 0; id < count; id++) {
+                glm::mat4 local;
+                glm::mat4 localNormal;
+                composeTransformsScalar(&view.translation(id), &view.rotation(id), &view.scale(id),
+                                        &local, &localNormal, 1);
+                world[id] = parents[id] == ZeTransformStore::NO_PARENT ? local : world[parents[id]] * local;
+                for (int column = 0; column < 4; column++) {
+                    for (int row = 0; row < 4; row++) {
+                        const float expected = world[id][column][row];
+                        if (std::abs(view.modelMatrix(id)[column][row] - expected) >
+                            TOLERANCE * std::max(1.0f, std::abs(expected))) {
+                            return false;
+                        }
+                    }
+                }
+            }
+            return true;
+        };
+
+        bool passed = true;
+        store.updateMatrices();
+        const uint32_t initialUpdates = store.getLastUpdateCount();
+        passed = passed && initialUpdates == count && matricesMatch();
+
+        // const reads only, nothing is recomputed
+        store.updateMatrices();
+        const uint32_t staticUpdates = store.getLastUpdateCount();
+        passed = passed && staticUpdates == 0;
+
+        // a moved transform recomputes itself and its descendants, nothing else
+        uint32_t mismatchedMoves = 0;
+        std::uniform_int_distribution<ZeTransformStore::id_t> ids{0, count - 1};
+        for (uint32_t move = 0; move < MOVE_COUNT; move++) {
+            // roots first, then any transform, and on odd moves one of its descendants too
+            const ZeTransformStore::id_t id = move < ROOT_COUNT ? move : ids(random);
+            store.translation(id).x += 1.0f;
+            if (move % 2 == 1 && !children[id].empty()) {
+                store.rotation(children[id].front()).y += 0.5f;
+            }
+            store.updateMatrices();
+            if (store.getLastUpdateCount() != subtreeSize(id) || !matricesMatch()) {
+                mismatchedMoves++;
+            }
+        }
+        passed = passed && mismatchedMoves == 0;
+
+        out << "{\n";
+        out << "  \"mode\": \"transform-dirty\",\n";
+        out << "  \"count\": " << count << ",\n";
+        out << "  \"initialUpdates\": " << initialUpdates << ",\n";
+        out << "  \"staticUpdates\": " << staticUpdates << ",\n";
+        out << "  \"moves\": " << MOVE_COUNT << ",\n";
+        out << "  \"mismatchedMoves\": " << mismatchedMoves << ",\n";
+        out << "  \"passed\": " << (passed ? "true" : "false") << "\n";
+        out << "}\n";
+        return passed;
+    }
+
+    bool runDrawListBenchmark(uint32_t count, std::ostream &out) {
+        // the request's budget for 100k transparent draws
+        static constexpr double TARGET_MS_PER_100K = 1.0;
+        count = std::max(count, 1u);
+        std::mt19937 random{42};
+        std::uniform_real_distribution<float> depths{0.0f, 100.0f};
+        std::uniform_int_distribution<uint32_t> pipelines{0, 7};
+        std::uniform_int_distribution<uint32_t> materials{0, 63};
+        std::vector<ZeDrawList::Item> keys(count);
+        for (uint32_t i = 0; i < count; i++) {
+            keys[i] = {ZeDrawList::makeKey(depths(random),
+                                           static_cast<uint16_t>(pipelines(random)),
+                                           static_cast<uint16_t>(materials(random))),
+                       i};
+        }
+        auto byKey = [](const ZeDrawList::Item &a, const ZeDrawList::Item &b) { return a.key < b.key; };
+
+        ZeDrawList drawList{};
+        drawList.reserve(count);
+        auto fill = [&]() {
+            drawList.clear();
+            for (const auto &item : keys) {
+                drawList.add(item.key, item.payload);
+            }
+        };
+        std::vector<ZeDrawList::Item> reference = keys;
+        std::stable_sort(reference.begin(), reference.end(), byKey);
+        fill();
+        drawList.sort();
+        const bool identical = std::equal(drawList.begin(), drawList.end(), reference.begin(), reference.end(),
+                                          [](const ZeDrawList::Item &a, const ZeDrawList::Item &b) {
+                                              return a.key == b.key && a.payload == b.payload;
+                                          });
+
+        // about ten million items per sort, best call of the iterations
+        const uint32_t iterations = std::max(10'000'000u / count, 3u);
+        double radixMs = std::numeric_limits<double>::max();
+        double stableSortMs = std::numeric_limits<double>::max();
+        for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+            fill();
+            auto start = Clock::now();
+            drawList.sort();
+            radixMs = std::min(radixMs, elapsedMs(start, Clock::now()));
+            reference = keys;
+            start = Clock::now();
+            std::stable_sort(reference.begin(), reference.end(), byKey);
+            stableSortMs = std::min(stableSortMs, elapsedMs(start, Clock::now()));
+        }
+        const double targetMs = TARGET_MS_PER_100K * count / 100000.0;
+
+        out << "{\n";
+        out << "  \"mode\": \"draw-list\",\n";
+        out << "  \"count\": " << count << ",\n";
+        out << "  \"identical\": " << (identical ? "true" : "false") << ",\n";
+        out << "  \"milliseconds\": { \"radixSort\": " << radixMs
+            << ", \"stableSort\": " << stableSortMs
+            << ", \"speedup\": " << stableSortMs / radixMs << " },\n";
+        // informative, timings depend on the machine
+        out << "  \"targetMilliseconds\": " << targetMs << ",\n";
+        out << "  \"withinTarget\": " << (radixMs <= targetMs ? "true" : "false") << "\n";
+        out << "}\n";
+        return identical;
+    }
+
+    bool runModelLoadBenchmark(const std::string &filepath, uint32_t count, std::ostream &out) {
+        count = std::max(count, 1u);
+        ZeThreadPool pool{};
+        ZeModel::Builder serial{};
+        ZeModel::Builder parallel{};
+        double serialMs = std::numeric_limits<double>::max();
+        double parallelMs = std::numeric_limits<double>::max();
+        // alternated, so both see the same file cache state
+        for (uint32_t iteration = 0; iteration < count; iteration++) {
+            auto start = Clock::now();
+            serial.loadModel(filepath);
+            serialMs = std::min(serialMs, elapsedMs(start, Clock::now()));
+            start = Clock::now();
+            parallel.loadModel(filepath, pool);
+            parallelMs = std::min(parallelMs, elapsedMs(start, Clock::now()));
+        }
+
+        const bool identical =
+                serial.indices == parallel.indices &&
+                serial.vertices.size() == parallel.vertices.size() &&
+                std::memcmp(serial.vertices.data(), parallel.vertices.data(),
+                            sizeof(ZeModel::Vertex) * serial.vertices.size()) == 0;
+
+        out << "{\n";
+        out << "  \"mode\": \"model-load\",\n";
+        out << "  \"model\": " << jsonString(filepath) << ",\n";
+        out << "  \"count\": " << count << ",\n";
+        out << "  \"threads\": " << pool.getThreadCount() << ",\n";
+        out << "  \"vertices\": " << serial.vertices.size() << ",\n";
+        out << "  \"indices\": " << serial.indices.size() << ",\n";
+        out << "  \"identical\": " << (identical ? "true" : "false") << ",\n";
+        out << "  \"milliseconds\": { \"serial\": " << serialMs
+            << ", \"parallel\": " << parallelMs
+            << ", \"speedup\": " << serialMs / parallelMs << " }\n";
+        out << "}\n";
+        return identical;
+    }
+
+    bool runAllocatorBenchmark(uint32_t count, std::ostream &out) {
+        ZeDevice zeDevice{};
+        auto &allocator = zeDevice.allocator();
+        // same sizes on every run : power of two sizes from 256 bytes to 256 KB, as small meshes
+        std::mt19937 random{42};
+        std::uniform_int_distribution<uint32_t> sizeExponents{8, 18};
+
+        // without sub-allocation every buffer would be a vkAllocateMemory call
+        const auto initial = allocator.getStats();
+        auto start = Clock::now();
+        std::vector<std::unique_ptr<ZeBuffer>> buffers;
+        buffers.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            buffers.push_back(std::make_unique<ZeBuffer>(
+                    zeDevice,
+                    VkDeviceSize{1} << sizeExponents(random),
+                    1,
+                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT));
+        }
+        const double createMs = elapsedMs(start, Clock::now());
+        const auto created = allocator.getStats();
+        start = Clock::now();
+        // no frame scheduler attached, the buffers are destroyed right away
+        buffers.clear();
+        const double destroyMs = elapsedMs(start, Clock::now());
+
+        // host visible ranges without a resource : a move is a copy, checked with a marker
+        VkMemoryRequirements requirements{};
+        requirements.alignment = 256;
+        requirements.memoryTypeBits = ~0u;
+        std::vector<ZeAllocation> allocations;
+        allocations.reserve(count);
+        for (uint32_t i = 0; i < count; i++) {
+            requirements.size = VkDeviceSize{1} << sizeExponents(random);
+            allocations.push_back(allocator.allocate(
+                    requirements,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                    true));
+            std::memcpy(allocations.back().mapped, &i, sizeof(i));
+        }
+        // every other one freed, the survivors scattered over all the blocks
+        std::unordered_map<void *, uint32_t> owners;
+        for (uint32_t i = 0; i < count; i++) {
+            if (i % 2 == 0) {
+                allocator.free(allocations[i]);
+                allocations[i] = ZeAllocation{};
+            } else {
+                owners[allocations[i].mapped] = i;
+            }
+        }
+        const auto fragmented = allocator.getStats();
+        start = Clock::now();
+        const uint32_t moved = allocator.defragment([&](const ZeAllocation &from, const ZeAllocation &to) {
+            auto owner = owners.find(from.mapped);
+            if (owner == owners.end()) {
+                return false;
+            }
+            std::memcpy(to.mapped, from.mapped, from.size);
+            const uint32_t index = owner->second;
+            owners.erase(owner);
+            owners[to.mapped] = index;
+            allocations[index] = to;
+            return true;
+        });
+        const double defragmentMs = elapsedMs(start, Clock::now());
+        const auto defragmented = allocator.getStats();
+
+        bool verified = true;
+        for (uint32_t i = 1; i < count; i += 2) {
+            uint32_t marker;
+            std::memcpy(&marker, allocations[i].mapped, sizeof(marker));
+            verified = verified && marker == i;
+            allocator.free(allocations[i]);
+        }
+
+        out << "{\n";
+        out << "  \"device\": " << jsonString(zeDevice.properties.deviceName) << ",\n";
+        out << "  \"mode\": \"allocator\",\n";
+        out << "  \"count\": " << count << ",\n";
+        out << "  \"maxMemoryAllocationCount\": " << zeDevice.properties.limits.maxMemoryAllocationCount << ",\n";
+        out << "  \"buffers\": {\n"
+            << "    \"vkAllocateMemory\": " << created.deviceMemoryAllocations - initial.deviceMemoryAllocations << ",\n"
+            << "    \"vkAllocateMemoryWithoutSubAllocation\": " << count << ",\n"
+            << "    \"createMilliseconds\": " << createMs << ",\n"
+            << "    \"destroyMilliseconds\": " << destroyMs << ",\n"
+            << "    \"created\": { ";
+        writeAllocatorStats(out, created);
+        out << " }\n"
+            << "  },\n";
+        out << "  \"defragment\": {\n"
+            << "    \"moved\": " << moved << ",\n"
+            << "    \"milliseconds\": " << defragmentMs << ",\n"
+            << "    \"verified\": " << (verified ? "true" : "false") << ",\n"
+            << "    \"before\": { ";
+        writeAllocatorStats(out, fragmented);
+        out << " },\n"
+            << "    \"after\": { ";
+        writeAllocatorStats(out, defragmented);
+        out << " }\n"
+            << "  }\n";
+        out << "}\n";
+        return verified;
+    }
+
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace ze {
+
+    // Measures of single engine parts, run by ze_benchmark --mode instead of rendering frames.
+    // Each one writes a JSON report to out.
+
+    // creates count buffers of mixed sizes and compares the vkAllocateMemory calls with one per
+    // buffer, then frees half of count host visible allocations and defragments the rest ; returns
+    // false when an allocation lost its content
+    bool runAllocatorBenchmark(uint32_t count, std::ostream &out);
+
+    // compares composeTransforms with composeTransformsScalar on count transforms per angle range
+    // (around 0, near +-pi, up to the 8192 radians of the SIMD sin/cos), then times both ; returns
+    // false when the SIMD matrices are out of tolerance
+    bool runTransformMathBenchmark(uint32_t count, std::ostream &out);
+
+    // updates the matrices of count transforms, every one changed, in ZeTransformStore and one by
+    // one in an unordered_map of objects holding their transform as before the store ; returns
+    // false when the matrices differ
+    bool runTransformStoreBenchmark(uint32_t count, std::ostream &out);
+
+    // checks the dirty tracking of ZeTransformStore on a random hierarchy of count transforms : a
+    // static scene recomputes no matrix, a moved transform exactly itself and its descendants ;
+    // returns false otherwise
+    bool runTransformDirtyCheck(uint32_t count, std::ostream &out);
+
+    // sorts count draw keys of random depths, pipelines and materials with ZeDrawList, checked
+    // against std::stable_sort, then times both ; returns false when the orders differ
+    bool runDrawListBenchmark(uint32_t count, std::ostream &out);
+
+    // loads the OBJ file count times with the serial and the parallel ZeModel::Builder::loadModel,
+    // the best time of each ; returns false when the two results differ
+    bool runModelLoadBenchmark(const std::string &filepath, uint32_t count, std::ostream &out);
+
+}
@@ -1,4 +1,7 @@
 #include "ze_model.hpp"
+#include "ze_mesh_cache.hpp"
+#include "ze_thread_pool.hpp"
+#include "ze_upload_batcher.hpp"
 #include "ze_utils.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
@@ -6,7 +9,9 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/gtx/hash.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
 #include <unordered_map>
 
@@ -22,26 +27,62 @@ namespace std {
 }
 
 namespace  ze {
-    ZeModel::ZeModel(ze::ZeDevice &device, const ZeModel::Builder &builder): zeDevice{device} {
-        createVertexBuffers(builder.vertices);
-        createIndexBuffers(builder.indices);
+    ZeModel::ZeModel(ze::ZeDevice &device, const ZeModel::Builder &builder, ZeUploadBatcher *uploader): zeDevice{device}, bounds{builder.bounds} {
+        createVertexBuffers(builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size()), uploader);
+        createIndexBuffers(builder.indices.data(), static_cast<uint32_t>(builder.indices.size()), uploader);
+    }
+
+    ZeModel::ZeModel(ZeDevice &device,
+                     const Vertex *vertices, uint32_t vertexCount,
+                     const uint32_t *indices, uint32_t indexCount,
+                     const Bounds &bounds,
+                     ZeUploadBatcher *uploader): zeDevice{device}, bounds{bounds} {
+        createVertexBuffers(vertices, vertexCount, uploader);
+        createIndexBuffers(indices, indexCount, uploader);
     }
 
     ZeModel::~ZeModel() {
     }
 
-    std::unique_ptr<ZeModel> ZeModel::createModelFromFile(ze::ZeDevice &device, const std::string &filepath) {
+    std::unique_ptr<ZeModel> ZeModel::createModelFromFile(ze::ZeDevice &device, const std::string &filepath, ZeThreadPool *pool, ZeUploadBatcher *uploader) {
+        // cached meshes are copied straight from the file mapping into the staging buffers
+        if (auto cache = ZeMeshCache::open(filepath)) {
+            return std::make_unique<ZeModel>(
+                    device,
+                    cache->getVertices(), cache->getVertexCount(),
+                    cache->getIndices(), cache->getIndexCount(),
+                    cache->getBounds(),
+                    uploader);
+        }
+
         Builder builder{};
-        builder.loadModel(filepath);
-        return std::make_unique<ZeModel>(device, builder);
+        if (pool != nullptr) {
+            builder.loadModel(filepath, *pool);
+        } else {
+            builder.loadModel(filepath);
+        }
+        ZeMeshCache::write(filepath, builder);
+        return std::make_unique<ZeModel>(device, builder, uploader);
     }
 
-    void ZeModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
-        vertexCount = static_cast<uint32_t>(vertices.size());
+    void ZeModel::createVertexBuffers(const Vertex *vertices, uint32_t count, ZeUploadBatcher *uploader) {
+        vertexCount = count;
         assert(vertexCount >= 3 && "Vertex count must be at leat 3");
         VkDeviceSize bufferSize = sizeof (vertices[0]) * vertexCount;
         uint32_t  vertexSize = sizeof(vertices[0]);
 
+        vertexBuffer = std::make_unique<ZeBuffer>(
+                zeDevice,
+                vertexSize,
+                vertexCount,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                );
+        if (uploader != nullptr) {
+            vertexBuffer->upload(*uploader, vertices, bufferSize);
+            return;
+        }
+
         ZeBuffer stagingBuffer {
             zeDevice,
             vertexSize,
@@ -50,20 +91,12 @@ namespace  ze {
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
         };
         stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)vertices.data());
-
-        vertexBuffer = std::make_unique<ZeBuffer>(
-                zeDevice,
-                vertexSize,
-                vertexCount,
-                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-                );
+        stagingBuffer.writeToBuffer((void*)vertices);
         zeDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
     }
 
-    void ZeModel::createIndexBuffers(const std::vector<uint32_t> &indices) {
-        indexCount = static_cast<uint32_t>(indices.size());
+    void ZeModel::createIndexBuffers(const uint32_t *indices, uint32_t count, ZeUploadBatcher *uploader) {
+        indexCount = count;
         hasIndexBuffer = indexCount > 0;
         if (!hasIndexBuffer) {
             return;
@@ -71,15 +104,6 @@ namespace  ze {
 
         VkDeviceSize bufferSize = sizeof (indices[0]) * indexCount;
         uint32_t  indexSize = sizeof(indices[0]);
-        ZeBuffer stagingBuffer {
-            zeDevice,
-            indexSize,
-            indexCount,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        };
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer((void*)indices.data());
 
         indexBuffer = std::make_unique<ZeBuffer>(
                 zeDevice,
@@ -88,14 +112,28 @@ namespace  ze {
                 VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
                 );
+        if (uploader != nullptr) {
+            indexBuffer->upload(*uploader, indices, bufferSize);
+            return;
+        }
+
+        ZeBuffer stagingBuffer {
+            zeDevice,
+            indexSize,
+            indexCount,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        };
+        stagingBuffer.map();
+        stagingBuffer.writeToBuffer((void*)indices);
         zeDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
     }
 
-    void ZeModel::draw(VkCommandBuffer commandBuffer) {
+    void ZeModel::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance) {
         if (hasIndexBuffer) {
-            vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+            vkCmdDrawIndexed(commandBuffer, indexCount, instanceCount, 0, 0, firstInstance);
         } else {
-            vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+            vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, firstInstance);
         }
     }
 
@@ -108,6 +146,27 @@ namespace  ze {
         }
     }
 
+    ZeModel::Bounds ZeModel::Bounds::compute(const Vertex *vertices, uint32_t vertexCount) {
+        Bounds bounds{};
+        if (vertexCount == 0) {
+            return bounds;
+        }
+        bounds.min = bounds.max = vertices[0].position;
+        for (uint32_t i = 1; i < vertexCount; i++) {
+            bounds.min = glm::min(bounds.min, vertices[i].position);
+            bounds.max = glm::max(bounds.max, vertices[i].position);
+        }
+        // tighter than the half diagonal of the box
+        bounds.center = (bounds.min + bounds.max) * 0.5f;
+        float radius2 = 0.0f;
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            glm::vec3 offset = vertices[i].position - bounds.center;
+            radius2 = std::max(radius2, glm::dot(offset, offset));
+        }
+        bounds.radius = std::sqrt(radius2);
+        return bounds;
+    }
+
     std::vector<VkVertexInputBindingDescription> ZeModel::Vertex::getBindingDescription() {
         std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
         bindingDescriptions[0].binding = 0;
@@ -127,15 +186,128 @@ namespace  ze {
         return attributeDescriptions;
     }
 
-    void ZeModel::Builder::loadModel(const std::string &filepath) {
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
+    static void loadObj(const std::string &filepath, tinyobj::attrib_t &attrib, std::vector<tinyobj::shape_t> &shapes) {
         std::vector<tinyobj::material_t> materials;
         std::string warn, err;
 
         if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, filepath.c_str())) {
             throw std::runtime_error(warn + err);
         }
+    }
+
+    // -0.0 becomes 0.0 and NaN becomes 0.0 : equal attributes then have equal bytes, so
+    // Vertex::operator== and the byte comparison of VertexTable agree
+    static float canonical(float value) {
+        return std::isnan(value) ? 0.0f : value + 0.0f;
+    }
+
+    static ZeModel::Vertex makeVertex(const tinyobj::attrib_t &attrib, const tinyobj::index_t &index) {
+        ZeModel::Vertex vertex{};
+        if (index.vertex_index >= 0) {
+            vertex.position = {
+                    canonical(attrib.vertices[3 * index.vertex_index + 0]),
+                    canonical(attrib.vertices[3 * index.vertex_index + 1]),
+                    canonical(attrib.vertices[3 * index.vertex_index + 2]),
+            };
+            vertex.color = {
+                    canonical(attrib.colors[3 * index.vertex_index + 0]),
+                    canonical(attrib.colors[3 * index.vertex_index + 1]),
+                    canonical(attrib.colors[3 * index.vertex_index + 2]),
+            };
+        }
+        if (index.normal_index >= 0) {
+            vertex.normal = {
+                    canonical(attrib.normals[3 * index.normal_index + 0]),
+                    canonical(attrib.normals[3 * index.normal_index + 1]),
+                    canonical(attrib.normals[3 * index.normal_index + 2]),
+            };
+        }
+        if (index.texcoord_index >= 0) {
+            vertex.uv = {
+                    canonical(attrib.texcoords[3 * index.texcoord_index + 0]),
+                    canonical(attrib.texcoords[3 * index.texcoord_index + 1]),
+            };
+        }
+        return vertex;
+    }
+
+    // below this many indices per chunk the merge costs more than the parallel dedup saves
+    static constexpr size_t MIN_PARALLEL_CHUNK = 64 * 1024;
+
+    static_assert(sizeof(ZeModel::Vertex) == 44, "VertexTable hashes and compares the raw Vertex bytes");
+
+    // Open addressing (linear probing) table of indices into a vertex array, keyed on the raw
+    // bytes of the vertices, which match Vertex::operator== for the canonical vertices of makeVertex.
+    class VertexTable {
+    public:
+        explicit VertexTable(size_t expectedCount) {
+            size_t capacity = 16;
+            while (capacity < expectedCount * 2) capacity <<= 1;
+            slots.assign(capacity, Slot{});
+        }
+
+        // returns the index of the vertex, appending it to vertices if it is new
+        uint32_t insert(const ZeModel::Vertex &vertex, std::vector<ZeModel::Vertex> &vertices) {
+            if ((count + 1) * 2 > slots.size()) {
+                grow(vertices);
+            }
+            const uint64_t hash = hashVertex(vertex);
+            const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+            size_t mask = slots.size() - 1;
+            for (size_t i = static_cast<size_t>(hash) & mask;; i = (i + 1) & mask) {
+                Slot &slot = slots[i];
+                if (slot.index == EMPTY) {
+                    slot.tag = tag;
+                    slot.index = static_cast<uint32_t>(vertices.size());
+                    vertices.push_back(vertex);
+                    count++;
+                    return slot.index;
+                }
+                if (slot.tag == tag && std::memcmp(&vertices[slot.index], &vertex, sizeof(ZeModel::Vertex)) == 0) {
+                    return slot.index;
+                }
+            }
+        }
+
+    private:
+        static constexpr uint32_t EMPTY = ~0u;
+
+        struct Slot {
+            uint32_t tag{0};
+            uint32_t index{EMPTY};
+        };
+
+        static uint64_t hashVertex(const ZeModel::Vertex &vertex) {
+            uint32_t words[sizeof(ZeModel::Vertex) / sizeof(uint32_t)];
+            std::memcpy(words, &vertex, sizeof(words));
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (uint32_t word : words) {
+                hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+                hash ^= hash >> 29;
+            }
+            return hash;
+        }
+
+        void grow(const std::vector<ZeModel::Vertex> &vertices) {
+            std::vector<Slot> old = std::move(slots);
+            slots.assign(old.size() * 2, Slot{});
+            size_t mask = slots.size() - 1;
+            for (const Slot &slot : old) {
+                if (slot.index == EMPTY) continue;
+                size_t i = static_cast<size_t>(hashVertex(vertices[slot.index])) & mask;
+                while (slots[i].index != EMPTY) i = (i + 1) & mask;
+                slots[i] = slot;
+            }
+        }
+
+        std::vector<Slot> slots;
+        size_t count{0};
+    };
+
+    void ZeModel::Builder::loadModel(const std::string &filepath) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        loadObj(filepath, attrib, shapes);
 
         vertices.clear();
         indices.clear();
@@ -144,32 +316,7 @@ namespace  ze {
 
         for(const auto &shape : shapes) {
             for (const auto &index : shape.mesh.indices) {
-                Vertex vertex{};
-                if (index.vertex_index >= 0) {
-                    vertex.position = {
-                            attrib.vertices[3 * index.vertex_index + 0],
-                            attrib.vertices[3 * index.vertex_index + 1],
-                            attrib.vertices[3 * index.vertex_index + 2],
-                    };
-                    vertex.color = {
-                            attrib.colors[3 * index.vertex_index + 0],
-                            attrib.colors[3 * index.vertex_index + 1],
-                            attrib.colors[3 * index.vertex_index + 2],
-                    };
-                }
-                if (index.normal_index >= 0) {
-                    vertex.normal = {
-                            attrib.normals[3 * index.normal_index + 0],
-                            attrib.normals[3 * index.normal_index + 1],
-                            attrib.normals[3 * index.normal_index + 2],
-                    };
-                }
-                if (index.texcoord_index >= 0) {
-                    vertex.uv = {
-                            attrib.texcoords[3 * index.texcoord_index + 0],
-                            attrib.texcoords[3 * index.texcoord_index + 1],
-                    };
-                }
+                Vertex vertex = makeVertex(attrib, index);
 
                 if (uniqueVertices.count(vertex) == 0) {
                     uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
@@ -178,11 +325,73 @@ namespace  ze {
                 indices.push_back(uniqueVertices[vertex]);
             }
         }
+        bounds = Bounds::compute(vertices.data(), static_cast<uint32_t>(vertices.size()));
     }
-}
 
+    void ZeModel::Builder::loadModel(const std::string &filepath, ZeThreadPool &pool) {
+        tinyobj::attrib_t attrib;
+        std::vector<tinyobj::shape_t> shapes;
+        loadObj(filepath, attrib, shapes);
 
+        vertices.clear();
+        indices.clear();
 
+        // split the index stream of every shape into contiguous chunks, in file order
+        struct Chunk {
+            const tinyobj::index_t *begin;
+            size_t count;
+            size_t firstIndex;
+            std::vector<Vertex> vertices;
+            std::vector<uint32_t> indices; // into Chunk::vertices, then into Builder::vertices
+        };
+        size_t totalIndices = 0;
+        for (const auto &shape : shapes) {
+            totalIndices += shape.mesh.indices.size();
+        }
+        const size_t chunkSize = std::max<size_t>(
+                MIN_PARALLEL_CHUNK,
+                totalIndices / (static_cast<size_t>(pool.getThreadCount()) * 4) + 1);
+        std::vector<Chunk> chunks;
+        size_t firstIndex = 0;
+        for (const auto &shape : shapes) {
+            const auto &shapeIndices = shape.mesh.indices;
+            for (size_t offset = 0; offset < shapeIndices.size(); offset += chunkSize) {
+                size_t count = std::min(chunkSize, shapeIndices.size() - offset);
+                chunks.push_back(Chunk{shapeIndices.data() + offset, count, firstIndex, {}, {}});
+                firstIndex += count;
+            }
+        }
 
+        // deduplicate each chunk locally
+        pool.parallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t c) {
+            Chunk &chunk = chunks[c];
+            VertexTable table{chunk.count / 2};
+            chunk.indices.resize(chunk.count);
+            for (size_t i = 0; i < chunk.count; i++) {
+                chunk.indices[i] = table.insert(makeVertex(attrib, chunk.begin[i]), chunk.vertices);
+            }
+        });
 
+        // merge in chunk order : local vertices are in order of first use, so the result is
+        // identical to the serial path whatever the number of threads
+        std::vector<std::vector<uint32_t>> remaps(chunks.size());
+        VertexTable table{totalIndices / 4};
+        for (size_t c = 0; c < chunks.size(); c++) {
+            remaps[c].resize(chunks[c].vertices.size());
+            for (size_t v = 0; v < chunks[c].vertices.size(); v++) {
+                remaps[c][v] = table.insert(chunks[c].vertices[v], vertices);
+            }
+            chunks[c].vertices = {};
+        }
 
+        indices.resize(totalIndices);
+        pool.parallelFor(static_cast<uint32_t>(chunks.size()), [&](uint32_t c) {
+            const Chunk &chunk = chunks[c];
+            const auto &remap = remaps[c];
+            for (size_t i = 0; i < chunk.count; i++) {
+                indices[chunk.firstIndex + i] = remap[chunk.indices[i]];
+            }
+        });
+        bounds = Bounds::compute(vertices.data(), static_cast<uint32_t>(vertices.size()));
+    }
+}
@@ -11,6 +11,9 @@
 #include <vector>
 
 namespace ze {
+    class ZeThreadPool;
+    class ZeUploadBatcher;
+
     class ZeModel {
     public:
 
@@ -28,28 +31,57 @@ namespace ze {
             }
         };
 
+        // object space bounds of the vertex positions, the sphere is centered on the box
+        struct Bounds {
+            glm::vec3 min{0.0f};
+            glm::vec3 max{0.0f};
+            glm::vec3 center{0.0f};
+            float radius{0.0f};
+
+            static Bounds compute(const Vertex *vertices, uint32_t vertexCount);
+        };
+
         struct Builder {
             std::vector<Vertex> vertices{};
             std::vector<uint32_t> indices{};
+            Bounds bounds{};
+            // both set the bounds of the loaded vertices
             void loadModel(const std::string &filepath);
+            // same result as loadModel(filepath), deduplicating vertices on the pool's threads
+            void loadModel(const std::string &filepath, ZeThreadPool &pool);
         };
 
-        ZeModel(ZeDevice &device, const ZeModel::Builder &builder);
+        // with an uploader the buffers are filled when it is flushed, instead of one blocking
+        // copy per buffer
+        ZeModel(ZeDevice &device, const ZeModel::Builder &builder, ZeUploadBatcher *uploader = nullptr);
+        ZeModel(ZeDevice &device,
+                const Vertex *vertices, uint32_t vertexCount,
+                const uint32_t *indices, uint32_t indexCount,
+                const Bounds &bounds,
+                ZeUploadBatcher *uploader = nullptr);
         ~ZeModel();
 
-        static std::unique_ptr<ZeModel> createModelFromFile(ZeDevice &device, const std::string &filepath);
+        static std::unique_ptr<ZeModel> createModelFromFile(
+                ZeDevice &device,
+                const std::string &filepath,
+                ZeThreadPool *pool = nullptr,
+                ZeUploadBatcher *uploader = nullptr);
 
         ZeModel(const ZeModel&) = delete;
         ZeModel &operator=(const ZeModel&) = delete;
 
         void bind(VkCommandBuffer commandBuffer);
-        void draw(VkCommandBuffer commandBuffer);
+        // instances read their per-instance attributes starting at firstInstance
+        void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+        const Bounds &getBounds() const { return bounds; }
 
     private:
-        void createVertexBuffers(const std::vector<Vertex> &vertices);
-        void createIndexBuffers(const std::vector<uint32_t> &indices);
+        void createVertexBuffers(const Vertex *vertices, uint32_t count, ZeUploadBatcher *uploader);
+        void createIndexBuffers(const uint32_t *indices, uint32_t count, ZeUploadBatcher *uploader);
 
         ZeDevice& zeDevice;
+        Bounds bounds;
 
             std::unique_ptr<ZeBuffer> vertexBuffer;
             uint32_t  vertexCount;
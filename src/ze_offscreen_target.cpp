@@ -0,0 +1,277 @@
+#include "ze_offscreen_target.hpp"
+#include "ze_cpu_profiler.hpp"
+
+#include <array>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace ze {
+
+    static bool isFourBytesColorFormat(VkFormat format) {
+        return format == VK_FORMAT_B8G8R8A8_SRGB || format == VK_FORMAT_B8G8R8A8_UNORM ||
+               format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_R8G8B8A8_UNORM;
+    }
+
+    ZeOffscreenTarget::ZeOffscreenTarget(ZeDevice &device, ZeFrameScheduler &scheduler, VkExtent2D extent, VkFormat colorFormat):
+            device{device}, scheduler{scheduler}, extent{extent}, colorFormat{colorFormat} {
+        assert(isFourBytesColorFormat(colorFormat) && "Offscreen color format must be 4 bytes per pixel");
+        depthFormat = device.findSupportedFormat(
+                {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+                VK_IMAGE_TILING_OPTIMAL,
+                VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+        createRenderPass();
+        createImages();
+        createFramebuffers();
+        imageFrameValues.assign(colorImages.size(), 0);
+    }
+
+    ZeOffscreenTarget::~ZeOffscreenTarget() {
+        // the frames in flight may still render to the images
+        device.destroyDeferred([&device = device,
+                                framebuffers = std::move(framebuffers),
+                                colorImages = std::move(colorImages),
+                                colorImageMemorys = std::move(colorImageMemorys),
+                                colorImageViews = std::move(colorImageViews),
+                                depthImages = std::move(depthImages),
+                                depthImageMemorys = std::move(depthImageMemorys),
+                                depthImageViews = std::move(depthImageViews),
+                                renderPass = renderPass]() {
+            for (auto framebuffer : framebuffers) {
+                vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+            }
+            for (size_t i = 0; i < colorImages.size(); i++) {
+                vkDestroyImageView(device.device(), colorImageViews[i], nullptr);
+                vkDestroyImage(device.device(), colorImages[i], nullptr);
+                device.allocator().free(colorImageMemorys[i]);
+                vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
+                vkDestroyImage(device.device(), depthImages[i], nullptr);
+                device.allocator().free(depthImageMemorys[i]);
+            }
+            vkDestroyRenderPass(device.device(), renderPass, nullptr);
+        });
+    }
+
+    VkResult ZeOffscreenTarget::acquireNextImage(uint32_t *imageIndex) {
+        // one image per frame in flight, the frame wait also guards the image
+        *imageIndex = static_cast<uint32_t>(scheduler.getFrameIndex());
+        return VK_SUCCESS;
+    }
+
+    VkResult ZeOffscreenTarget::submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) {
+        assert(*imageIndex == static_cast<uint32_t>(scheduler.getFrameIndex()) && "Submitting an image that was not acquired");
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = buffers;
+
+        imageFrameValues[*imageIndex] = scheduler.getFrameValue();
+        std::lock_guard<std::mutex> lock{device.queueMutex()};
+        ZE_PROFILE_SCOPE("queue submit");
+        return scheduler.submit(device.graphicsQueue(), submitInfo);
+    }
+
+    void ZeOffscreenTarget::recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex) {
+        // the render pass leaves the color image in TRANSFER_SRC_OPTIMAL, its outgoing dependency
+        // makes the attachment writes visible to the copy
+        VkBufferImageCopy region{};
+        region.bufferOffset = 0;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = {extent.width, extent.height, 1};
+        vkCmdCopyImageToBuffer(
+                commandBuffer,
+                colorImages[imageIndex],
+                VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                readbackBuffers[imageIndex]->getBuffer(),
+                1,
+                &region);
+
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = readbackBuffers[imageIndex]->getBuffer();
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(
+                commandBuffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT,
+                VK_PIPELINE_STAGE_HOST_BIT,
+                0,
+                0, nullptr,
+                1, &barrier,
+                0, nullptr);
+    }
+
+    void ZeOffscreenTarget::readPixels(uint32_t imageIndex, std::vector<uint8_t> &pixels) {
+        scheduler.wait(imageFrameValues[imageIndex]);
+        auto &buffer = *readbackBuffers[imageIndex];
+        buffer.invalidate();
+        pixels.resize(buffer.getBufferSize());
+        memcpy(pixels.data(), buffer.getMappedMemory(), pixels.size());
+    }
+
+    void ZeOffscreenTarget::createRenderPass() {
+        // same attachments and subpass as ZeSwapChain::createRenderPass, only the color final
+        // layout differs, which keeps both render passes compatible
+        VkAttachmentDescription depthAttachment{};
+        depthAttachment.format = depthFormat;
+        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference depthAttachmentRef{};
+        depthAttachmentRef.attachment = 1;
+        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = colorFormat;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+        VkAttachmentReference colorAttachmentRef{};
+        colorAttachmentRef.attachment = 0;
+        colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+        std::array<VkSubpassDependency, 2> dependencies{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        // the depth image is cleared again while the previous frame may still test against it
+        dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                       VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                       VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                       VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                       VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask =
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        // color writes before the readback copy
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen render pass!");
+        }
+    }
+
+    void ZeOffscreenTarget::createImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                                        VkImage &image, ZeAllocation &memory, VkImageView &view) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent.width = extent.width;
+        imageInfo.extent.height = extent.height;
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = usage;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.flags = 0;
+        device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, memory);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange.aspectMask = aspect;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        if (vkCreateImageView(device.device(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create offscreen image view!");
+        }
+    }
+
+    void ZeOffscreenTarget::createImages() {
+        colorImages.resize(scheduler.getFramesInFlight());
+        colorImageMemorys.resize(scheduler.getFramesInFlight());
+        colorImageViews.resize(scheduler.getFramesInFlight());
+        depthImages.resize(scheduler.getFramesInFlight());
+        depthImageMemorys.resize(scheduler.getFramesInFlight());
+        depthImageViews.resize(scheduler.getFramesInFlight());
+
+        for (size_t i = 0; i < scheduler.getFramesInFlight(); i++) {
+            createImage(colorFormat,
+                        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                        VK_IMAGE_ASPECT_COLOR_BIT,
+                        colorImages[i], colorImageMemorys[i], colorImageViews[i]);
+            createImage(depthFormat,
+                        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                        VK_IMAGE_ASPECT_DEPTH_BIT,
+                        depthImages[i], depthImageMemorys[i], depthImageViews[i]);
+
+            readbackBuffers.push_back(std::make_unique<ZeBuffer>(
+                    device,
+                    4,
+                    extent.width * extent.height,
+                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+            readbackBuffers.back()->map();
+        }
+    }
+
+    void ZeOffscreenTarget::createFramebuffers() {
+        framebuffers.resize(imageCount());
+        for (size_t i = 0; i < imageCount(); i++) {
+            std::array<VkImageView, 2> attachments = {colorImageViews[i], depthImageViews[i]};
+
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = renderPass;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+            framebufferInfo.pAttachments = attachments.data();
+            framebufferInfo.width = extent.width;
+            framebufferInfo.height = extent.height;
+            framebufferInfo.layers = 1;
+            if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create offscreen framebuffer!");
+            }
+        }
+    }
+
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ze_buffer.hpp"
+#include "ze_device.hpp"
+#include "ze_frame_scheduler.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace ze {
+
+    // Render target without a surface, the headless counterpart of ZeSwapChain : one color and
+    // depth framebuffer per frame in flight, with a render pass compatible with the swap chain one
+    // so the same pipelines render into both. Frames can be copied back to host memory.
+    class ZeOffscreenTarget {
+    public:
+        // the format ZeSwapChain prefers, pipelines are compatible when both agree
+        static constexpr VkFormat DEFAULT_COLOR_FORMAT = VK_FORMAT_B8G8R8A8_SRGB;
+
+        ZeOffscreenTarget(ZeDevice &device, ZeFrameScheduler &scheduler, VkExtent2D extent,
+                          VkFormat colorFormat = DEFAULT_COLOR_FORMAT);
+        ~ZeOffscreenTarget();
+
+        ZeOffscreenTarget(const ZeOffscreenTarget &) = delete;
+        ZeOffscreenTarget &operator=(const ZeOffscreenTarget &) = delete;
+
+        VkFramebuffer getFrameBuffer(int index) const { return framebuffers[index]; }
+        VkRenderPass getRenderPass() const { return renderPass; }
+        VkImage getColorImage(int index) const { return colorImages[index]; }
+        size_t imageCount() const { return colorImages.size(); }
+        VkFormat getColorFormat() const { return colorFormat; }
+        VkFormat getDepthFormat() const { return depthFormat; }
+        VkExtent2D getExtent() const { return extent; }
+        float extentAspectRatio() const {
+            return static_cast<float>(extent.width) / static_cast<float>(extent.height);
+        }
+
+        // same contract as ZeSwapChain, the image of the frame slot is free once
+        // scheduler.beginFrame() returned
+        VkResult acquireNextImage(uint32_t *imageIndex);
+        VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+
+        // records the copy of the color image to its readback buffer, after the render pass
+        void recordReadback(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+        // waits for the frame rendered into imageIndex and copies its recorded readback, tightly
+        // packed rows of 4 bytes pixels in the color format
+        void readPixels(uint32_t imageIndex, std::vector<uint8_t> &pixels);
+
+    private:
+        void createRenderPass();
+        void createImages();
+        void createFramebuffers();
+        void createImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect,
+                         VkImage &image, ZeAllocation &memory, VkImageView &view);
+
+        ZeDevice &device;
+        ZeFrameScheduler &scheduler;
+        VkExtent2D extent;
+        VkFormat colorFormat;
+        VkFormat depthFormat;
+
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        std::vector<VkImage> colorImages;
+        std::vector<ZeAllocation> colorImageMemorys;
+        std::vector<VkImageView> colorImageViews;
+        std::vector<VkImage> depthImages;
+        std::vector<ZeAllocation> depthImageMemorys;
+        std::vector<VkImageView> depthImageViews;
+        std::vector<VkFramebuffer> framebuffers;
+        std::vector<std::unique_ptr<ZeBuffer>> readbackBuffers;
+
+        // timeline value of the last frame rendered into each image
+        std::vector<uint64_t> imageFrameValues;
+    };
+
+}
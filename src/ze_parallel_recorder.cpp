@@ -0,0 +1,82 @@
+#include "ze_parallel_recorder.hpp"
+#include "ze_cpu_profiler.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace ze {
+
+    ZeParallelRecorder::ZeParallelRecorder(ZeDevice &device, uint32_t frameCount, uint32_t workerCount):
+            workers{workerCount}, framePools{device, frameCount, workers.getThreadCount() + 1} {
+        slotBuffers.resize(framePools.getSlotCount());
+    }
+
+    ZeParallelRecorder::~ZeParallelRecorder() {
+    }
+
+    void ZeParallelRecorder::beginFrame(int frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent) {
+        assert(pendingBuffers.empty() && "secondary command buffers recorded but not executed");
+        this->renderPass = renderPass;
+        this->framebuffer = framebuffer;
+        this->extent = extent;
+
+        // the buffers of the previous use of this frame have completed
+        currentFrameIndex = frameIndex;
+        framePools.reset(frameIndex);
+    }
+
+    VkCommandBuffer ZeParallelRecorder::beginCommandBuffer(uint32_t slot) {
+        auto commandBuffer = framePools.allocate(currentFrameIndex, slot, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+        VkCommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritanceInfo.renderPass = renderPass;
+        inheritanceInfo.subpass = 0;
+        inheritanceInfo.framebuffer = framebuffer;
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritanceInfo;
+        if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("failed to begin recording secondary command buffer");
+        }
+
+        // dynamic states are not inherited from the primary buffer
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float >(extent.width);
+        viewport.height = static_cast<float >(extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        VkRect2D scissor{{0, 0}, extent};
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        return commandBuffer;
+    }
+
+    void ZeParallelRecorder::record(uint32_t count, const std::function<void(uint32_t, VkCommandBuffer)> &fn) {
+        assert(currentFrameIndex >= 0 && "record called before beginFrame");
+        assert(count <= framePools.getSlotCount() && "more secondary command buffers than recording slots");
+        workers.parallelFor(count, [this, &fn](uint32_t slot) {
+            ZE_PROFILE_SCOPE("record secondary");
+            auto commandBuffer = beginCommandBuffer(slot);
+            fn(slot, commandBuffer);
+            if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to end secondary command buffer");
+            }
+            slotBuffers[slot] = commandBuffer;
+        });
+        pendingBuffers.insert(pendingBuffers.end(), slotBuffers.begin(), slotBuffers.begin() + count);
+    }
+
+    void ZeParallelRecorder::execute(VkCommandBuffer primaryCommandBuffer) {
+        if (pendingBuffers.empty()) {
+            return;
+        }
+        vkCmdExecuteCommands(primaryCommandBuffer, static_cast<uint32_t>(pendingBuffers.size()), pendingBuffers.data());
+        pendingBuffers.clear();
+    }
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ze_device.hpp"
+#include "ze_frame_command_pools.hpp"
+#include "ze_thread_pool.hpp"
+
+#include <functional>
+#include <vector>
+
+namespace ze {
+
+    // Records the render pass in secondary command buffers on a pool of workers, from frame
+    // command pools with one slot per recording thread (the calling thread plus the workers).
+    // Recorded buffers are executed from the primary buffer in recording order when the render
+    // pass ends.
+    class ZeParallelRecorder {
+    public:
+        ZeParallelRecorder(ZeDevice &device, uint32_t frameCount, uint32_t workerCount);
+        ~ZeParallelRecorder();
+
+        ZeParallelRecorder(const ZeParallelRecorder &) = delete;
+        ZeParallelRecorder &operator=(const ZeParallelRecorder &) = delete;
+
+        // number of secondary buffers record() can fill at once
+        uint32_t getSlotCount() const { return framePools.getSlotCount(); }
+
+        // called by ZeRenderer once the frame has been started
+        void beginFrame(int frameIndex, VkRenderPass renderPass, VkFramebuffer framebuffer, VkExtent2D extent);
+
+        // runs fn(slot, commandBuffer) for slot in [0, count) concurrently, each with its own
+        // secondary buffer, begun inside the render pass with the viewport and scissor set
+        void record(uint32_t count, const std::function<void(uint32_t, VkCommandBuffer)> &fn);
+
+        // executes the buffers recorded since the last call, inside the render pass
+        void execute(VkCommandBuffer primaryCommandBuffer);
+
+    private:
+        VkCommandBuffer beginCommandBuffer(uint32_t slot);
+
+        // parallelFor runs the first slot on the calling thread
+        ZeThreadPool workers;
+        ZeFrameCommandPools framePools;
+        int currentFrameIndex = -1;
+
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+        VkExtent2D extent{};
+
+        std::vector<VkCommandBuffer> slotBuffers;
+        std::vector<VkCommandBuffer> pendingBuffers;
+    };
+
+}
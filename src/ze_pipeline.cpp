@@ -1,96 +1,35 @@
 #include "ze_pipeline.hpp"
+#include "ze_pipeline_library.hpp"
 #include "ze_model.hpp"
 
-#include <fstream>
 #include <stdexcept>
-#include <iostream>
-#include <cassert>
 
 namespace ze {
     ZePipeline::ZePipeline(ZeDevice &device, const std::string &vertFilePath, const std::string &fragFilePath, const PipelineConfigInfo &configInfo): zeDevice{device} {
-        createGraphicsPipeline(vertFilePath, fragFilePath, configInfo);
+        pendingPipeline = zeDevice.pipelineLibrary().compile(vertFilePath, fragFilePath, configInfo);
     }
 
     ZePipeline::~ZePipeline() {
-        vkDestroyShaderModule(zeDevice.device(), vertShaderModule, nullptr);
-        vkDestroyShaderModule(zeDevice.device(), fragShaderModule, nullptr);
-        vkDestroyPipeline(zeDevice.device(), graphicsPipeline, nullptr);
-    }
-
-    void ZePipeline::createGraphicsPipeline(const std::string &vertFilePath, const std::string &fragFilePath, const PipelineConfigInfo &configInfo) {
-        assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "pipelineLayout is null");
-        assert(configInfo.renderPass != VK_NULL_HANDLE && "renderPass is null");
-
-        auto vertCode = readFile(vertFilePath);
-        auto fragCode = readFile(fragFilePath);
-
-        createShaderModule(vertCode, &vertShaderModule);
-        createShaderModule(fragCode, &fragShaderModule);
-
-        VkPipelineShaderStageCreateInfo shaderStages[2];
-        shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-        shaderStages[0].module = vertShaderModule;
-        shaderStages[0].pName = "main";
-        shaderStages[0].flags = 0;
-        shaderStages[0].pNext = nullptr;
-        shaderStages[0].pSpecializationInfo = nullptr;
-
-        shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        shaderStages[1].module = fragShaderModule;
-        shaderStages[1].pName = "main";
-        shaderStages[1].flags = 0;
-        shaderStages[1].pNext = nullptr;
-        shaderStages[1].pSpecializationInfo = nullptr;
-
-        auto& bindingDescription = configInfo.bindingDescriptions;
-        auto& attributeDescription = configInfo.attributeDescriptions;
-
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescription.size());
-        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescription.size());
-        vertexInputInfo.pVertexAttributeDescriptions = attributeDescription.data();
-        vertexInputInfo.pVertexBindingDescriptions = bindingDescription.data();
-
-        VkGraphicsPipelineCreateInfo pipelineInfo{};
-        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-        pipelineInfo.stageCount = 2;
-        pipelineInfo.pStages = shaderStages;
-        pipelineInfo.pVertexInputState = &vertexInputInfo;
-        pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
-        pipelineInfo.pViewportState = &configInfo.viewportInfo;
-        pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
-        pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
-        pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
-        pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
-        pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
-
-        pipelineInfo.layout = configInfo.pipelineLayout;
-        pipelineInfo.renderPass = configInfo.renderPass;
-        pipelineInfo.subpass = configInfo.subpass;
-
-        pipelineInfo.basePipelineIndex = -1;
-        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-
-        if (vkCreateGraphicsPipelines(zeDevice.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create graphices pipeline");
+        VkPipeline pipeline;
+        try {
+            pipeline = pendingPipeline.get();
+        } catch (const std::exception &) {
+            // never created, the error was thrown to the users of the pipeline
+            return;
         }
+        // the frames in flight may still draw with it
+        zeDevice.destroyDeferred([&device = zeDevice, pipeline]() {
+            vkDestroyPipeline(device.device(), pipeline, nullptr);
+        });
     }
 
-    void ZePipeline::createShaderModule(const std::vector<char> &code, VkShaderModule *shaderModule) {
-        VkShaderModuleCreateInfo createInfo{};
-        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
-        if (vkCreateShaderModule(zeDevice.device(), &createInfo, nullptr, shaderModule) != VK_SUCCESS) {
-            throw std::runtime_error("failed to create shader module");
-        }
+    VkPipeline ZePipeline::getPipeline() {
+        std::call_once(pipelineReady, [this]() { graphicsPipeline = pendingPipeline.get(); });
+        return graphicsPipeline;
     }
 
     void ZePipeline::bind(VkCommandBuffer commandBuffer) {
-        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, getPipeline());
     }
 
     void ZePipeline::defaultPipelineConfigInfo(PipelineConfigInfo& configInfo) {
@@ -166,19 +105,6 @@ namespace ze {
         configInfo.attributeDescriptions = ZeModel::Vertex::getAttributeDescription();
     }
 
-    std::vector<char> ZePipeline::readFile(const std::string& filepath) {
-        std::ifstream file{filepath, std::ios::ate | std::ios::binary};
-        if (!file.is_open()) {
-            throw std::runtime_error("filed to open file : " + filepath);
-        }
-        size_t fileSize = static_cast<size_t>(file.tellg());
-        std::vector<char> buffer(fileSize);
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-        file.close();
-        return buffer;
-    }
-
     void ZePipeline::enableAlphaBlending(ze::PipelineConfigInfo &configInfo) {
         configInfo.colorBlendAttachment.blendEnable = VK_TRUE;
 
@@ -1,6 +1,8 @@
 #pragma once
 #include "ze_device.hpp"
 
+#include <future>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -28,6 +30,9 @@ namespace ze {
         uint32_t subpass = 0;
     };
 
+    // Created by the device pipeline library on a worker thread : the constructor returns right
+    // away and the first bind() waits for the pipeline, so the pipelines constructed together are
+    // compiled in parallel.
     class ZePipeline {
     public:
         ZePipeline(ZeDevice &device,
@@ -39,22 +44,17 @@ namespace ze {
         ZePipeline(const ZePipeline&) = delete;
         ZePipeline& operator=(const ZePipeline&) = delete;
 
+        // blocks the first time, until the pipeline is created. Rethrows its creation error
+        VkPipeline getPipeline();
         void bind(VkCommandBuffer commandBuffer);
         static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
         static void enableAlphaBlending(PipelineConfigInfo& configInfo);
 
     private:
-        static std::vector<char> readFile(const std::string& filepath);
-
-        void createGraphicsPipeline(const std::string& vertFilePath,
-                                    const std::string& fragFilePath,
-                                    const PipelineConfigInfo &configInfo);
-
-        void createShaderModule(const std::vector<char>&code, VkShaderModule* shaderModule);
-
         ZeDevice& zeDevice;
-        VkPipeline graphicsPipeline;
-        VkShaderModule vertShaderModule;
-        VkShaderModule fragShaderModule;
+        std::shared_future<VkPipeline> pendingPipeline;
+        // bind() can be called from the recording threads
+        std::once_flag pipelineReady;
+        VkPipeline graphicsPipeline = VK_NULL_HANDLE;
     };
 }
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "ze_pipeline_library.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+
+namespace ze {
+
+    // PipelineConfigInfo points into itself, the copy is pointed at its own members
+    static void copyPipelineConfigInfo(const PipelineConfigInfo &source, PipelineConfigInfo &target) {
+        target.bindingDescriptions = source.bindingDescriptions;
+        target.attributeDescriptions = source.attributeDescriptions;
+        target.viewportInfo = source.viewportInfo;
+        target.inputAssemblyInfo = source.inputAssemblyInfo;
+        target.rasterizationInfo = source.rasterizationInfo;
+        target.multisampleInfo = source.multisampleInfo;
+        target.colorBlendAttachment = source.colorBlendAttachment;
+        target.colorBlendInfo = source.colorBlendInfo;
+        target.colorBlendInfo.pAttachments = &target.colorBlendAttachment;
+        target.depthStencilInfo = source.depthStencilInfo;
+        target.dynamicStateEnables = source.dynamicStateEnables;
+        target.dynamicStateInfo = source.dynamicStateInfo;
+        target.dynamicStateInfo.pDynamicStates = target.dynamicStateEnables.data();
+        target.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(target.dynamicStateEnables.size());
+        target.pipelineLayout = source.pipelineLayout;
+        target.renderPass = source.renderPass;
+        target.subpass = source.subpass;
+    }
+
+    // FNV-1a
+    static uint64_t hashCode(const std::vector<char> &code) {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : code) {
+            hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    ZePipelineLibrary::ZePipelineLibrary(ZeDevice &device, uint32_t workerCount):
+            zeDevice{device}, workerCount{std::max(workerCount, 1u)} {
+    }
+
+    ZePipelineLibrary::~ZePipelineLibrary() {
+        {
+            // the workers drain the queued jobs before exiting
+            std::unique_lock<std::mutex> lock{jobsMutex};
+            workersDone.wait(lock, [this]() { return runningWorkers == 0; });
+        }
+        for (auto &kv : modulesByHash) {
+            vkDestroyShaderModule(zeDevice.device(), kv.second.module, nullptr);
+        }
+    }
+
+    std::vector<char> ZePipelineLibrary::readFile(const std::string &filepath) {
+        std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+        if (!file.is_open()) {
+            throw std::runtime_error("filed to open file : " + filepath);
+        }
+        size_t fileSize = static_cast<size_t>(file.tellg());
+        std::vector<char> buffer(fileSize);
+        file.seekg(0);
+        file.read(buffer.data(), fileSize);
+        file.close();
+        return buffer;
+    }
+
+    VkShaderModule ZePipelineLibrary::getShaderModule(const std::string &filepath) {
+        {
+            std::lock_guard<std::mutex> lock{modulesMutex};
+            auto it = modulesByPath.find(filepath);
+            if (it != modulesByPath.end()) {
+                return it->second;
+            }
+        }
+        // read unlocked, the workers load their files concurrently
+        auto code = readFile(filepath);
+        const uint64_t hash = hashCode(code);
+
+        std::lock_guard<std::mutex> lock{modulesMutex};
+        auto it = modulesByPath.find(filepath);
+        if (it != modulesByPath.end()) {
+            return it->second;
+        }
+        auto range = modulesByHash.equal_range(hash);
+        for (auto same = range.first; same != range.second; ++same) {
+            if (same->second.code == code) {
+                modulesByPath[filepath] = same->second.module;
+                return same->second.module;
+            }
+        }
+
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = code.size();
+        createInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+        VkShaderModule module;
+        if (vkCreateShaderModule(zeDevice.device(), &createInfo, nullptr, &module) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shader module");
+        }
+        modulesByHash.emplace(hash, ShaderModule{std::move(code), module});
+        modulesByPath[filepath] = module;
+        return module;
+    }
+
+    std::shared_future<VkPipeline> ZePipelineLibrary::compile(const std::string &vertFilepath,
+                                                              const std::string &fragFilepath,
+                                                              const PipelineConfigInfo &configInfo) {
+        assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "pipelineLayout is null");
+        assert(configInfo.renderPass != VK_NULL_HANDLE && "renderPass is null");
+        auto config = std::make_shared<PipelineConfigInfo>();
+        copyPipelineConfigInfo(configInfo, *config);
+        auto job = std::make_shared<std::packaged_task<VkPipeline()>>([this, vertFilepath, fragFilepath, config]() {
+            return createGraphicsPipeline(vertFilepath, fragFilepath, *config);
+        });
+        auto pipeline = job->get_future().share();
+
+        std::lock_guard<std::mutex> lock{jobsMutex};
+        if (!compiled) {
+            compiled = true;
+            firstCompile = std::chrono::steady_clock::now();
+        }
+        jobs.emplace_back([job]() { (*job)(); });
+        if (runningWorkers < workerCount && runningWorkers < jobs.size()) {
+            runningWorkers++;
+            std::thread{[this]() { workerLoop(); }}.detach();
+        }
+        return pipeline;
+    }
+
+    void ZePipelineLibrary::workerLoop() {
+        std::unique_lock<std::mutex> lock{jobsMutex};
+        while (!jobs.empty()) {
+            auto job = std::move(jobs.front());
+            jobs.pop_front();
+            lock.unlock();
+            // a packaged task, the errors go to the future
+            job();
+            const auto now = std::chrono::steady_clock::now();
+            lock.lock();
+            zeDevice.setPipelineCreationWallTime(
+                    std::chrono::duration<double, std::milli>(now - firstCompile).count());
+        }
+        // the last access to the library, the destructor may run once the lock is released
+        runningWorkers--;
+        workersDone.notify_all();
+    }
+
+    VkPipeline ZePipelineLibrary::createGraphicsPipeline(const std::string &vertFilepath,
+                                                         const std::string &fragFilepath,
+                                                         const PipelineConfigInfo &configInfo) {
+        VkPipelineShaderStageCreateInfo shaderStages[2];
+        shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shaderStages[0].module = getShaderModule(vertFilepath);
+        shaderStages[0].pName = "main";
+        shaderStages[0].flags = 0;
+        shaderStages[0].pNext = nullptr;
+        shaderStages[0].pSpecializationInfo = nullptr;
+
+        shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[1].module = getShaderModule(fragFilepath);
+        shaderStages[1].pName = "main";
+        shaderStages[1].flags = 0;
+        shaderStages[1].pNext = nullptr;
+        shaderStages[1].pSpecializationInfo = nullptr;
+
+        auto& bindingDescription = configInfo.bindingDescriptions;
+        auto& attributeDescription = configInfo.attributeDescriptions;
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescription.size());
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescription.size());
+        vertexInputInfo.pVertexAttributeDescriptions = attributeDescription.data();
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescription.data();
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = shaderStages;
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
+        pipelineInfo.pViewportState = &configInfo.viewportInfo;
+        pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
+        pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
+        pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
+        pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
+        pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
+
+        pipelineInfo.layout = configInfo.pipelineLayout;
+        pipelineInfo.renderPass = configInfo.renderPass;
+        pipelineInfo.subpass = configInfo.subpass;
+
+        pipelineInfo.basePipelineIndex = -1;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        // the pipeline cache is internally synchronized, the workers share it
+        VkPipeline graphicsPipeline;
+        const auto start = std::chrono::steady_clock::now();
+        if (vkCreateGraphicsPipelines(zeDevice.device(), zeDevice.pipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create graphices pipeline");
+        }
+        zeDevice.addPipelineCreationTime(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        return graphicsPipeline;
+    }
+
+}
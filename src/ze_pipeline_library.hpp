@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ze_device.hpp"
+#include "ze_pipeline.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ze {
+
+    // Shader modules shared between the pipelines, and pipelines created on worker threads through
+    // the device pipeline cache : the pipelines requested together (the systems of a renderer,
+    // material permutations) are compiled in parallel, each ZePipeline only waits for its own one
+    // when it is first bound. The worker threads start with a batch and exit once it is drained,
+    // nothing stays idle after startup. Owned by ZeDevice, see ZeDevice::pipelineLibrary().
+    class ZePipelineLibrary {
+    public:
+        explicit ZePipelineLibrary(ZeDevice &device, uint32_t workerCount = std::thread::hardware_concurrency());
+        // waits for the pending pipelines and the workers, the created ones belong to their ZePipeline
+        ~ZePipelineLibrary();
+
+        ZePipelineLibrary(const ZePipelineLibrary&) = delete;
+        ZePipelineLibrary &operator=(const ZePipelineLibrary&) = delete;
+
+        // created once per path, and once for identical SPIR-V files. Can be called from any thread
+        VkShaderModule getShaderModule(const std::string &filepath);
+
+        // queues the creation on a worker, started when fewer than workerCount run. configInfo is
+        // copied, the layout and the render pass must live until the pipeline is created
+        std::shared_future<VkPipeline> compile(const std::string &vertFilepath,
+                                               const std::string &fragFilepath,
+                                               const PipelineConfigInfo &configInfo);
+
+    private:
+        struct ShaderModule {
+            std::vector<char> code;
+            VkShaderModule module;
+        };
+
+        static std::vector<char> readFile(const std::string &filepath);
+        VkPipeline createGraphicsPipeline(const std::string &vertFilepath,
+                                          const std::string &fragFilepath,
+                                          const PipelineConfigInfo &configInfo);
+
+        void workerLoop();
+
+        ZeDevice &zeDevice;
+        const uint32_t workerCount;
+
+        std::mutex modulesMutex;
+        std::unordered_map<std::string, VkShaderModule> modulesByPath;
+        // by hash of the SPIR-V, the code tells the collisions apart
+        std::unordered_multimap<uint64_t, ShaderModule> modulesByHash;
+
+        // detached workers, the destructor waits until none runs : the pending jobs use the modules
+        std::mutex jobsMutex;
+        std::condition_variable workersDone;
+        std::deque<std::function<void()>> jobs;
+        uint32_t runningWorkers{0};
+        bool compiled{false};
+        // creation wall time, from the first compile() to the last completion
+        std::chrono::steady_clock::time_point firstCompile;
+    };
+
+}
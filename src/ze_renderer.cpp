@@ -7,61 +7,54 @@
 namespace ze {
 
 
-    ZeRenderer::ZeRenderer(ZeWindow& window, ZeDevice& device): zeWindow(window), zeDevice{device}  {
+    ZeRenderer::ZeRenderer(ZeWindow& window, ZeDevice& device, uint32_t framesInFlight):
+            zeWindow(&window), zeDevice{device}, frameScheduler{device, framesInFlight},
+            framePools{device, framesInFlight, 1}, gpuProfiler{device, framesInFlight}  {
         recreateSwapChain();
-        createCommandsBuffers();
+        commandBuffers.resize(framesInFlight);
     }
 
-    ZeRenderer::~ZeRenderer() {
-        freeCommanBuffers();
-    }
-
-    void ZeRenderer::createCommandsBuffers() {
-        commandBuffers.resize(ZeSwapChain::MAX_FRAMES_IN_FLIGHT);
-
-        VkCommandBufferAllocateInfo allocateInfo{};
-        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        allocateInfo.commandPool = zeDevice.getCommandPool();
-        allocateInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-
-        if (vkAllocateCommandBuffers(zeDevice.device(), &allocateInfo, commandBuffers.data()) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate command buffers");
-        }
+    ZeRenderer::ZeRenderer(ZeDevice& device, VkExtent2D extent, uint32_t framesInFlight):
+            zeWindow(nullptr), zeDevice{device}, frameScheduler{device, framesInFlight},
+            framePools{device, framesInFlight, 1}, gpuProfiler{device, framesInFlight}  {
+        offscreenTarget = std::make_unique<ZeOffscreenTarget>(zeDevice, frameScheduler, extent);
+        commandBuffers.resize(framesInFlight);
     }
 
-    void ZeRenderer::freeCommanBuffers() {
-        vkFreeCommandBuffers(zeDevice.device(),
-                             zeDevice.getCommandPool(),
-                             static_cast<uint32_t >(commandBuffers.size()),
-                             commandBuffers.data());
-        commandBuffers.clear();
+    ZeRenderer::~ZeRenderer() {
     }
 
     void ZeRenderer::recreateSwapChain() {
-        auto extent = zeWindow.getExtent();
+        auto extent = zeWindow->getExtent();
         while (extent.width == 0 || extent.height == 0) {
-            extent = zeWindow.getExtent();
+            extent = zeWindow->getExtent();
             glfwWaitEvents();
         }
-        vkDeviceWaitIdle(zeDevice.device());
 
         if (zeSwapChain == nullptr) {
-            zeSwapChain = std::make_unique<ZeSwapChain>(zeDevice, extent);
+            zeSwapChain = std::make_unique<ZeSwapChain>(zeDevice, frameScheduler, extent);
         } else {
             std::shared_ptr<ZeSwapChain> oldSwapChain = std::move(zeSwapChain);
-            zeSwapChain = std::make_unique<ZeSwapChain>(zeDevice, extent, oldSwapChain);
+            zeSwapChain = std::make_unique<ZeSwapChain>(zeDevice, frameScheduler, extent, oldSwapChain);
 
             if (!oldSwapChain->compareSwapFormats(*zeSwapChain.get())) {
                 throw std::runtime_error("Swap chain image format has changed");
             }
+            // no device idle : the old images, framebuffers and semaphores go once the frames
+            // submitted to them are complete
+            frameScheduler.retire([oldSwapChain]() {});
         }
     }
 
     VkCommandBuffer ZeRenderer::beginFrame() {
         assert(!isFrameStarted && "can't call beginFrame while already in progress");
 
-        auto result = zeSwapChain->acquireNextImage(&currentImageIndex);
+        // the single wait of the frame : until the GPU is done with the previous use of the slot
+        frameScheduler.beginFrame();
+        currentFrameIndex = frameScheduler.getFrameIndex();
+        auto result = isHeadless() ?
+                offscreenTarget->acquireNextImage(&currentImageIndex) :
+                zeSwapChain->acquireNextImage(&currentImageIndex);
         if (result == VK_ERROR_OUT_OF_DATE_KHR) {
             recreateSwapChain();
             return nullptr;
@@ -72,12 +65,24 @@ namespace ze {
 
         isFrameStarted = true;
 
+        // the previous command buffer of the frame is done
+        framePools.reset(currentFrameIndex);
+        commandBuffers[currentFrameIndex] = framePools.allocate(currentFrameIndex, 0, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
         auto commandBuffer = getCurrentCommandBUffer();
         VkCommandBufferBeginInfo beginInfo{};
         beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
         if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
             throw std::runtime_error("failed to begin recording command buffer");
         }
+        gpuProfiler.beginFrame(commandBuffer, currentFrameIndex);
+        if (parallelRecorder != nullptr) {
+            parallelRecorder->beginFrame(
+                    currentFrameIndex,
+                    getSwapChainRenderPass(),
+                    isHeadless() ? offscreenTarget->getFrameBuffer(currentImageIndex) : zeSwapChain->getFrameBuffer(currentImageIndex),
+                    isHeadless() ? offscreenTarget->getExtent() : zeSwapChain->getSwapChainExtent());
+        }
         return commandBuffer;
     }
 
@@ -85,32 +90,48 @@ namespace ze {
         assert(isFrameStarted && "can't call endFrame while frame not in progress");
 
         auto commandBuffer = getCurrentCommandBUffer();
+        if (isHeadless() && readbackEnabled) {
+            offscreenTarget->recordReadback(commandBuffer, currentImageIndex);
+        }
         if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
             throw std::runtime_error("failed to end command buffer");
         }
 
+        if (isHeadless()) {
+            if (offscreenTarget->submitCommandBuffers(&commandBuffer, &currentImageIndex) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit offscreen frame");
+            }
+            lastSubmittedImageIndex = currentImageIndex;
+            hasSubmittedFrame = true;
+            isFrameStarted = false;
+            return;
+        }
+
         auto result = zeSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || zeWindow.wasWindowResized()) {
-            zeWindow.resetWindowResizedFlag();
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || zeWindow->wasWindowResized()) {
+            zeWindow->resetWindowResizedFlag();
             recreateSwapChain();
         } else if (result != VK_SUCCESS) {
             throw std::runtime_error("failed to present swap chain");
         }
         isFrameStarted = false;
-        currentFrameIndex = (currentFrameIndex + 1) % ZeSwapChain::MAX_FRAMES_IN_FLIGHT;
     }
 
     void ZeRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer) {
         assert(isFrameStarted && "can't call beginSwapChainRenderPass while frame not in progress");
         assert(commandBuffer == getCurrentCommandBUffer() && "beginSwapChainRenderPass bad commandBuffer");
 
+        VkExtent2D extent = isHeadless() ? offscreenTarget->getExtent() : zeSwapChain->getSwapChainExtent();
+
         VkRenderPassBeginInfo renderPassBeginInfo{};
         renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassBeginInfo.renderPass = zeSwapChain->getRenderPass();
-        renderPassBeginInfo.framebuffer = zeSwapChain->getFrameBuffer(currentImageIndex);
+        renderPassBeginInfo.renderPass = getSwapChainRenderPass();
+        renderPassBeginInfo.framebuffer = isHeadless() ?
+                offscreenTarget->getFrameBuffer(currentImageIndex) :
+                zeSwapChain->getFrameBuffer(currentImageIndex);
 
         renderPassBeginInfo.renderArea.offset = {0, 0};
-        renderPassBeginInfo.renderArea.extent = zeSwapChain->getSwapChainExtent();
+        renderPassBeginInfo.renderArea.extent = extent;
 
         std::array<VkClearValue, 2> clearValues{};
         clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
@@ -118,16 +139,23 @@ namespace ze {
         renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
         renderPassBeginInfo.pClearValues = clearValues.data();
 
+        renderPassScope = gpuProfiler.beginScope(commandBuffer, "render pass");
+        if (parallelRecorder != nullptr) {
+            vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            // only vkCmdExecuteCommands is allowed in the primary buffer until the end of the pass
+            gpuProfiler.setScopesSuspended(true);
+            return;
+        }
         vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = static_cast<float >(zeSwapChain->getSwapChainExtent().width);
-        viewport.height = static_cast<float >(zeSwapChain->getSwapChainExtent().height);
+        viewport.width = static_cast<float >(extent.width);
+        viewport.height = static_cast<float >(extent.height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-        VkRect2D scissor{{0, 0}, zeSwapChain->getSwapChainExtent()};
+        VkRect2D scissor{{0, 0}, extent};
         vkCmdSetViewport (commandBuffer, 0, 1, &viewport);
         vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
     }
@@ -135,6 +163,29 @@ namespace ze {
     void ZeRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer) {
         assert(isFrameStarted && "can't call endSwapChainRenderPass while frame not in progress");
         assert(commandBuffer == getCurrentCommandBUffer() && "endSwapChainRenderPass bad commandBuffer");
+        if (parallelRecorder != nullptr) {
+            parallelRecorder->execute(commandBuffer);
+            gpuProfiler.setScopesSuspended(false);
+        }
         vkCmdEndRenderPass(commandBuffer);
+        gpuProfiler.endScope(commandBuffer, renderPassScope);
+        renderPassScope = ZeGpuProfiler::INVALID_SCOPE;
+    }
+
+    void ZeRenderer::setParallelRecording(uint32_t workerCount) {
+        assert(!isFrameStarted && "can't change the recording mode while a frame is in progress");
+        // the secondary buffers of the frames in flight belong to the previous recorder
+        std::shared_ptr<ZeParallelRecorder> previous = std::move(parallelRecorder);
+        if (previous != nullptr) {
+            frameScheduler.retire([previous]() {});
+        }
+        parallelRecorder = workerCount == 0 ? nullptr : std::make_unique<ZeParallelRecorder>(
+                zeDevice, frameScheduler.getFramesInFlight(), workerCount);
+    }
+
+    void ZeRenderer::readLastFrame(std::vector<uint8_t> &pixels) {
+        assert(isHeadless() && readbackEnabled && "readLastFrame needs a headless renderer with readback enabled");
+        assert(hasSubmittedFrame && "no frame submitted yet");
+        offscreenTarget->readPixels(lastSubmittedImageIndex, pixels);
     }
 }
\ No newline at end of file
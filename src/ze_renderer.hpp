@@ -3,6 +3,11 @@
 #include "ze_window.hpp"
 #include "ze_device.hpp"
 #include "ze_swap_chain.hpp"
+#include "ze_offscreen_target.hpp"
+#include "ze_gpu_profiler.hpp"
+#include "ze_parallel_recorder.hpp"
+#include "ze_frame_command_pools.hpp"
+#include "ze_frame_scheduler.hpp"
 
 #include <memory>
 #include <vector>
@@ -12,15 +17,28 @@ namespace ze {
 
     class ZeRenderer {
     public:
-        ZeRenderer(ZeWindow& zeWindow, ZeDevice& zeDevice);
+        ZeRenderer(ZeWindow& zeWindow, ZeDevice& zeDevice,
+                   uint32_t framesInFlight = ZeFrameScheduler::DEFAULT_FRAMES_IN_FLIGHT);
+        // headless, renders into a ZeOffscreenTarget of a fixed extent
+        ZeRenderer(ZeDevice& zeDevice, VkExtent2D extent,
+                   uint32_t framesInFlight = ZeFrameScheduler::DEFAULT_FRAMES_IN_FLIGHT);
         ~ZeRenderer();
 
         ZeRenderer(const ZeRenderer&) = delete;
         ZeRenderer &operator=(const ZeRenderer&) = delete;
 
-        VkRenderPass getSwapChainRenderPass() const { return zeSwapChain->getRenderPass(); }
-        float getAspectRatio() const { return zeSwapChain->extentAspectRatio(); }
+        VkRenderPass getSwapChainRenderPass() const {
+            return isHeadless() ? offscreenTarget->getRenderPass() : zeSwapChain->getRenderPass();
+        }
+        float getAspectRatio() const {
+            return isHeadless() ? offscreenTarget->extentAspectRatio() : zeSwapChain->extentAspectRatio();
+        }
         bool isFrameInProgress() const { return isFrameStarted; }
+        // size the per frame resources (uniform buffers, descriptor sets) with it
+        uint32_t getFramesInFlight() const { return frameScheduler.getFramesInFlight(); }
+        // retire() resources the frames in flight may still use instead of waiting for the device
+        ZeFrameScheduler &getFrameScheduler() { return frameScheduler; }
+        bool isHeadless() const { return zeWindow == nullptr; }
 
         VkCommandBuffer getCurrentCommandBUffer() const {
             assert(isFrameStarted && "cannot get command buffer when frame not in progress");
@@ -35,18 +53,42 @@ namespace ze {
         VkCommandBuffer beginFrame();
         void endFrame();
 
+        // the render pass is a GPU profiler scope, with parallel recording it only accepts
+        // secondary command buffers, executed by endSwapChainRenderPass
         void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
         void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
+        // records the render pass in secondary command buffers on workerCount threads, 0 to record
+        // inline in the primary buffer, call between frames
+        void setParallelRecording(uint32_t workerCount);
+        // nullptr when recording inline
+        ZeParallelRecorder *getParallelRecorder() { return parallelRecorder.get(); }
+
+        // frames are started on the profiler, add scopes around the render systems
+        ZeGpuProfiler &getGpuProfiler() { return gpuProfiler; }
+        const ZeGpuProfiler &getGpuProfiler() const { return gpuProfiler; }
+
+        // headless only : copy each frame to host memory, then read the last submitted one
+        void setReadbackEnabled(bool enabled) { readbackEnabled = enabled; }
+        void readLastFrame(std::vector<uint8_t> &pixels);
+
     private:
-        void createCommandsBuffers();
-        void freeCommanBuffers();
         void recreateSwapChain();
 
-        ZeWindow& zeWindow;
+        ZeWindow* zeWindow;
         ZeDevice& zeDevice;
+        ZeFrameScheduler frameScheduler;
+        // the primary buffer of a frame is allocated from its pool, reset when the frame starts
+        ZeFrameCommandPools framePools;
+        ZeGpuProfiler gpuProfiler;
+        std::unique_ptr<ZeParallelRecorder> parallelRecorder;
+        uint32_t renderPassScope{ZeGpuProfiler::INVALID_SCOPE};
 
         std::unique_ptr<ZeSwapChain> zeSwapChain;
+        std::unique_ptr<ZeOffscreenTarget> offscreenTarget;
+        bool readbackEnabled{false};
+        bool hasSubmittedFrame{false};
+        uint32_t lastSubmittedImageIndex{0};
         std::vector<VkCommandBuffer> commandBuffers;
 
         uint32_t currentImageIndex{0};
@@ -0,0 +1,8 @@
+#pragma once
+
+// Instruction sets available at build time. Every SIMD kernel keeps a scalar path, defining
+// ZE_NO_SIMD (ZE_SIMD=OFF in CMake) forces it.
+#if !defined(ZE_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define ZE_SIMD_SSE 1
+#include <emmintrin.h>
+#endif
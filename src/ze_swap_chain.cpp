@@ -1,4 +1,5 @@
 #include "ze_swap_chain.hpp"
+#include "ze_cpu_profiler.hpp"
 
 // std
 #include <array>
@@ -9,16 +10,16 @@
 
 namespace ze {
 
-ZeSwapChain::ZeSwapChain(ZeDevice &deviceRef, VkExtent2D extent)
-    : device{deviceRef}, windowExtent{extent} {
+ZeSwapChain::ZeSwapChain(ZeDevice &deviceRef, ZeFrameScheduler &scheduler, VkExtent2D extent)
+    : device{deviceRef}, scheduler{scheduler}, windowExtent{extent} {
     init();
 }
 
-ZeSwapChain::ZeSwapChain(ZeDevice &deviceRef, VkExtent2D extent, std::shared_ptr<ZeSwapChain> previous)
-        : device{deviceRef}, windowExtent{extent}, oldSwapChain{previous} {
+ZeSwapChain::ZeSwapChain(ZeDevice &deviceRef, ZeFrameScheduler &scheduler, VkExtent2D extent, std::shared_ptr<ZeSwapChain> previous)
+        : device{deviceRef}, scheduler{scheduler}, windowExtent{extent}, oldSwapChain{previous} {
     init();
 
-    // clean up old swap chain
+    // only needed while creating, the renderer retires the old swap chain
     oldSwapChain = nullptr;
 }
 
@@ -32,49 +33,54 @@ void ZeSwapChain::init() {
 }
 
 ZeSwapChain::~ZeSwapChain() {
-  for (auto imageView : swapChainImageViews) {
-    vkDestroyImageView(device.device(), imageView, nullptr);
-  }
-  swapChainImageViews.clear();
+  // the frames in flight may still render to the attachments and wait on the semaphores
+  device.destroyDeferred([&device = device,
+                          imageViews = std::move(swapChainImageViews),
+                          swapChain = swapChain,
+                          depthImages = std::move(depthImages),
+                          depthImageMemorys = std::move(depthImageMemorys),
+                          depthImageViews = std::move(depthImageViews),
+                          framebuffers = std::move(swapChainFramebuffers),
+                          renderPass = renderPass,
+                          imageAvailableSemaphores = std::move(imageAvailableSemaphores),
+                          renderFinishedSemaphores = std::move(renderFinishedSemaphores)]() {
+    for (auto imageView : imageViews) {
+      vkDestroyImageView(device.device(), imageView, nullptr);
+    }
 
-  if (swapChain != nullptr) {
-    vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
-    swapChain = nullptr;
-  }
+    if (swapChain != nullptr) {
+      vkDestroySwapchainKHR(device.device(), swapChain, nullptr);
+    }
 
-  for (int i = 0; i < depthImages.size(); i++) {
-    vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-    vkDestroyImage(device.device(), depthImages[i], nullptr);
-    vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
-  }
+    for (size_t i = 0; i < depthImages.size(); i++) {
+      vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
+      vkDestroyImage(device.device(), depthImages[i], nullptr);
+      device.allocator().free(depthImageMemorys[i]);
+    }
 
-  for (auto framebuffer : swapChainFramebuffers) {
-    vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
-  }
+    for (auto framebuffer : framebuffers) {
+      vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+    }
 
-  vkDestroyRenderPass(device.device(), renderPass, nullptr);
+    vkDestroyRenderPass(device.device(), renderPass, nullptr);
 
-  // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
-    vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(device.device(), inFlightFences[i], nullptr);
-  }
+    // cleanup synchronization objects
+    for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
+      vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
+      vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
+    }
+  });
+  swapChain = nullptr;
 }
 
 VkResult ZeSwapChain::acquireNextImage(uint32_t *imageIndex) {
-  vkWaitForFences(
-      device.device(),
-      1,
-      &inFlightFences[currentFrame],
-      VK_TRUE,
-      std::numeric_limits<uint64_t>::max());
-
+  // the submission that waited on the semaphore of this slot is complete
+  ZE_PROFILE_SCOPE("acquire image");
   VkResult result = vkAcquireNextImageKHR(
       device.device(),
       swapChain,
       std::numeric_limits<uint64_t>::max(),
-      imageAvailableSemaphores[currentFrame],  // must be a not signaled semaphore
+      imageAvailableSemaphores[scheduler.getFrameIndex()],  // must be a not signaled semaphore
       VK_NULL_HANDLE,
       imageIndex);
 
@@ -83,10 +89,9 @@ VkResult ZeSwapChain::acquireNextImage(uint32_t *imageIndex) {
 
 VkResult ZeSwapChain::submitCommandBuffers(
     const VkCommandBuffer *buffers, uint32_t *imageIndex) {
-  if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-    vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
-  }
-  imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
+  // no wait on the previous frame rendering into the image : the acquire semaphore is signaled
+  // once its presentation, and so its rendering, is done
+  const int currentFrame = scheduler.getFrameIndex();
 
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -104,10 +109,12 @@ VkResult ZeSwapChain::submitCommandBuffers(
   submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
-  vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
-  if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
-      VK_SUCCESS) {
-    throw std::runtime_error("failed to submit draw command buffer!");
+  std::lock_guard<std::mutex> lock{device.queueMutex()};
+  {
+    ZE_PROFILE_SCOPE("queue submit");
+    if (scheduler.submit(device.graphicsQueue(), submitInfo) != VK_SUCCESS) {
+      throw std::runtime_error("failed to submit draw command buffer!");
+    }
   }
 
   VkPresentInfoKHR presentInfo = {};
@@ -122,11 +129,8 @@ VkResult ZeSwapChain::submitCommandBuffers(
 
   presentInfo.pImageIndices = imageIndex;
 
-  auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
-
-  currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
-
-  return result;
+  ZE_PROFILE_SCOPE("queue present");
+  return vkQueuePresentKHR(device.presentQueue(), &presentInfo);
 }
 
 void ZeSwapChain::createSwapChain() {
@@ -212,6 +216,14 @@ void ZeSwapChain::createImageViews() {
 }
 
 void ZeSwapChain::createRenderPass() {
+  // a recreated swap chain takes over the render pass of the previous one when the formats agree
+  if (oldSwapChain != nullptr && oldSwapChain->swapChainImageFormat == swapChainImageFormat &&
+      oldSwapChain->swapChainDepthFormat == findDepthFormat()) {
+    renderPass = oldSwapChain->renderPass;
+    oldSwapChain->renderPass = VK_NULL_HANDLE;
+    return;
+  }
+
   VkAttachmentDescription depthAttachment{};
   depthAttachment.format = findDepthFormat();
   depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -246,14 +258,18 @@ void ZeSwapChain::createRenderPass() {
   subpass.pColorAttachments = &colorAttachmentRef;
   subpass.pDepthStencilAttachment = &depthAttachmentRef;
 
+  // the depth writes of the previous frames are ordered too : depth images of a recreated swap
+  // chain may alias the memory of the previous ones
   VkSubpassDependency dependency = {};
   dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-  dependency.srcAccessMask = 0;
-  dependency.srcStageMask =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
   dependency.dstSubpass = 0;
-  dependency.dstStageMask =
-      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                            VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                            VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
   dependency.dstAccessMask =
       VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
@@ -306,7 +322,7 @@ void ZeSwapChain::createDepthResources() {
   depthImageMemorys.resize(imageCount());
   depthImageViews.resize(imageCount());
 
-  for (int i = 0; i < depthImages.size(); i++) {
+  for (size_t i = 0; i < depthImages.size(); i++) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -323,11 +339,34 @@ void ZeSwapChain::createDepthResources() {
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.flags = 0;
 
-    device.createImageWithInfo(
-        imageInfo,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        depthImages[i],
-        depthImageMemorys[i]);
+    if (vkCreateImage(device.device(), &imageInfo, nullptr, &depthImages[i]) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create depth image!");
+    }
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device.device(), depthImages[i], &memRequirements);
+
+    // when the extent shrinks the memory of the previous depth image is taken over, the old
+    // image is destroyed with the old swap chain without freeing it
+    bool reused = false;
+    if (oldSwapChain != nullptr && i < oldSwapChain->depthImageMemorys.size()) {
+      auto &previous = oldSwapChain->depthImageMemorys[i];
+      if (previous.block != nullptr && memRequirements.size <= previous.size &&
+          previous.offset % memRequirements.alignment == 0 &&
+          (memRequirements.memoryTypeBits & (1u << previous.memoryTypeIndex))) {
+        depthImageMemorys[i] = previous;
+        previous = {};
+        reused = true;
+      }
+    }
+    if (!reused) {
+      depthImageMemorys[i] = device.allocator().allocate(
+          memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+    }
+    if (vkBindImageMemory(
+            device.device(), depthImages[i], depthImageMemorys[i].memory, depthImageMemorys[i].offset) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to bind depth image memory!");
+    }
 
     VkImageViewCreateInfo viewInfo{};
     viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -347,24 +386,17 @@ void ZeSwapChain::createDepthResources() {
 }
 
 void ZeSwapChain::createSyncObjects() {
-  imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-  imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+  imageAvailableSemaphores.resize(scheduler.getFramesInFlight());
+  renderFinishedSemaphores.resize(scheduler.getFramesInFlight());
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-  VkFenceCreateInfo fenceInfo = {};
-  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
     if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
             VK_SUCCESS ||
         vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
-            VK_SUCCESS ||
-        vkCreateFence(device.device(), &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS) {
+            VK_SUCCESS) {
       throw std::runtime_error("failed to create synchronization objects for a frame!");
     }
   }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ze_device.hpp"
+#include "ze_frame_scheduler.hpp"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
@@ -14,10 +15,10 @@ namespace ze {
 
 class ZeSwapChain {
  public:
-  static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-   ZeSwapChain(ZeDevice &deviceRef, VkExtent2D windowExtent);
-   ZeSwapChain(ZeDevice &deviceRef, VkExtent2D windowExtent, std::shared_ptr<ZeSwapChain> previous);
+  // the frames are paced by the scheduler, the swap chain only has its acquire and present
+  // semaphores per frame in flight
+   ZeSwapChain(ZeDevice &deviceRef, ZeFrameScheduler &scheduler, VkExtent2D windowExtent);
+   ZeSwapChain(ZeDevice &deviceRef, ZeFrameScheduler &scheduler, VkExtent2D windowExtent, std::shared_ptr<ZeSwapChain> previous);
   ~ZeSwapChain();
 
    ZeSwapChain(const ZeSwapChain &) = delete;
@@ -37,6 +38,7 @@ class ZeSwapChain {
   }
   VkFormat findDepthFormat();
 
+  // call once scheduler.beginFrame() returned
   VkResult acquireNextImage(uint32_t *imageIndex);
   VkResult submitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
 
@@ -69,12 +71,13 @@ class ZeSwapChain {
   VkRenderPass renderPass;
 
   std::vector<VkImage> depthImages;
-  std::vector<VkDeviceMemory> depthImageMemorys;
+  std::vector<ZeAllocation> depthImageMemorys;
   std::vector<VkImageView> depthImageViews;
   std::vector<VkImage> swapChainImages;
   std::vector<VkImageView> swapChainImageViews;
 
   ZeDevice &device;
+  ZeFrameScheduler &scheduler;
   VkExtent2D windowExtent;
 
   VkSwapchainKHR swapChain;
@@ -82,9 +85,6 @@ class ZeSwapChain {
 
   std::vector<VkSemaphore> imageAvailableSemaphores;
   std::vector<VkSemaphore> renderFinishedSemaphores;
-  std::vector<VkFence> inFlightFences;
-  std::vector<VkFence> imagesInFlight;
-  size_t currentFrame = 0;
 };
 
 }  // namespace lve
@@ -0,0 +1,80 @@
+#include "ze_thread_pool.hpp"
+
+#include <algorithm>
+
+namespace ze {
+
+    ZeThreadPool::ZeThreadPool(uint32_t threadCount) {
+        threadCount = std::max(threadCount, 1u);
+        workers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            workers.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ZeThreadPool::~ZeThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            stopping = true;
+        }
+        condition.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    void ZeThreadPool::enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock{mutex};
+            tasks.push(std::move(task));
+        }
+        condition.notify_one();
+    }
+
+    void ZeThreadPool::workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock{mutex};
+                condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                // pending tasks are drained before the workers exit
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+    void ZeThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)> &fn) {
+        if (count == 0) {
+            return;
+        }
+        std::vector<std::future<void>> futures;
+        futures.reserve(count - 1);
+        for (uint32_t i = 1; i < count; i++) {
+            futures.push_back(submit([&fn, i]() { fn(i); }));
+        }
+
+        std::exception_ptr error;
+        try {
+            fn(0);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        // always wait for every task : they reference fn and the caller's stack
+        for (auto &future : futures) {
+            try {
+                future.get();
+            } catch (...) {
+                if (!error) error = std::current_exception();
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace ze {
+
+    class ZeThreadPool {
+    public:
+        explicit ZeThreadPool(uint32_t threadCount = std::thread::hardware_concurrency());
+        ~ZeThreadPool();
+
+        ZeThreadPool(const ZeThreadPool&) = delete;
+        ZeThreadPool &operator=(const ZeThreadPool&) = delete;
+
+        template<typename F>
+        auto submit(F &&task) -> std::future<decltype(task())> {
+            using R = decltype(task());
+            auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+            auto future = packaged->get_future();
+            enqueue([packaged]() { (*packaged)(); });
+            return future;
+        }
+
+        // Runs fn(0..count-1) across the workers and the calling thread, returns once all calls are
+        // done and rethrows the first exception. Must not be called from a worker of this pool.
+        void parallelFor(uint32_t count, const std::function<void(uint32_t)> &fn);
+
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+    private:
+        void enqueue(std::function<void()> task);
+        void workerLoop();
+
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool stopping{false};
+    };
+
+}
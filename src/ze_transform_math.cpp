@@ -0,0 +1,164 @@
+#include "ze_transform_math.hpp"
+#include "ze_simd.hpp"
+
+#include <cmath>
+
+namespace ze {
+
+    void composeTransformsScalar(const glm::vec3 *translations, const glm::vec3 *rotations, const glm::vec3 *scales,
+                                 glm::mat4 *modelMatrices, glm::mat4 *normalMatrices, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const glm::vec3 &rotation = rotations[i];
+            const glm::vec3 &scale = scales[i];
+            const float c3 = std::cos(rotation.z);
+            const float s3 = std::sin(rotation.z);
+            const float c2 = std::cos(rotation.x);
+            const float s2 = std::sin(rotation.x);
+            const float c1 = std::cos(rotation.y);
+            const float s1 = std::sin(rotation.y);
+
+            const glm::vec3 x{c1 * c3 + s1 * s2 * s3, c2 * s3, c1 * s2 * s3 - c3 * s1};
+            const glm::vec3 y{c3 * s1 * s2 - c1 * s3, c2 * c3, c1 * c3 * s2 + s1 * s3};
+            const glm::vec3 z{c2 * s1, -s2, c1 * c2};
+
+            glm::mat4 &model = modelMatrices[i];
+            model[0] = glm::vec4(x * scale.x, 0.0f);
+            model[1] = glm::vec4(y * scale.y, 0.0f);
+            model[2] = glm::vec4(z * scale.z, 0.0f);
+            model[3] = glm::vec4(translations[i], 1.0f);
+
+            const glm::vec3 invScale = 1.0f / scale;
+            glm::mat4 &normal = normalMatrices[i];
+            normal[0] = glm::vec4(x * invScale.x, 0.0f);
+            normal[1] = glm::vec4(y * invScale.y, 0.0f);
+            normal[2] = glm::vec4(z * invScale.z, 0.0f);
+            normal[3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+
+#ifdef ZE_SIMD_SSE
+    // Cephes single precision sin/cos : reduction by multiples of pi/2 in three parts, then
+    // minimax polynomials on [-pi/4, pi/4]. Max error is a few ulp for |x| < 8192.
+    static constexpr float TWO_OVER_PI = 0.636619772367581343f;
+    static constexpr float PI_OVER_2_PART1 = 1.5703125f;
+    static constexpr float PI_OVER_2_PART2 = 4.837512969970703125e-4f;
+    static constexpr float PI_OVER_2_PART3 = 7.54978995489188216e-8f;
+    static constexpr float SIN_C1 = -1.6666654611e-1f;
+    static constexpr float SIN_C2 = 8.3321608736e-3f;
+    static constexpr float SIN_C3 = -1.9515295891e-4f;
+    static constexpr float COS_C1 = 4.166664568298827e-2f;
+    static constexpr float COS_C2 = -1.388731625493765e-3f;
+    static constexpr float COS_C3 = 2.443315711809948e-5f;
+
+    static inline void sinCos(__m128 x, __m128 &s, __m128 &c) {
+        // quadrant q, round to nearest
+        __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TWO_OVER_PI)));
+        __m128 qf = _mm_cvtepi32_ps(q);
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(PI_OVER_2_PART1)));
+        r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(PI_OVER_2_PART2)));
+        r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(PI_OVER_2_PART3)));
+
+        __m128 r2 = _mm_mul_ps(r, r);
+        __m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_C3), r2), _mm_set1_ps(SIN_C2));
+        sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, r2), _mm_set1_ps(SIN_C1));
+        sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, r2), r), r);
+        __m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_C3), r2), _mm_set1_ps(COS_C2));
+        cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, r2), _mm_set1_ps(COS_C1));
+        cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, r2), r2);
+        cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(r2, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+        // odd quadrants swap sin and cos, quadrants 2,3 negate sin, quadrants 1,2 negate cos
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+        __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+        __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(
+                _mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+        s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cosPoly), _mm_andnot_ps(swap, sinPoly)), sinSign);
+        c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sinPoly), _mm_andnot_ps(swap, cosPoly)), cosSign);
+    }
+
+    // writes lane k of (a, b, c, w) as column `column` of matrices[k]
+    static inline void storeColumns(glm::mat4 *matrices, int column, __m128 a, __m128 b, __m128 c, __m128 w) {
+        _MM_TRANSPOSE4_PS(a, b, c, w);
+        _mm_storeu_ps(&matrices[0][column].x, a);
+        _mm_storeu_ps(&matrices[1][column].x, b);
+        _mm_storeu_ps(&matrices[2][column].x, c);
+        _mm_storeu_ps(&matrices[3][column].x, w);
+    }
+
+    // Euler rotation columns and scales of four transforms, one lane each
+    struct Basis4 {
+        __m128 xx, xy, xz, yx, yy, yz, zx, zy, zz;
+        __m128 sx, sy, sz;
+    };
+
+    static inline Basis4 composeBasis(__m128 s1, __m128 c1, __m128 s2, __m128 c2, __m128 s3, __m128 c3) {
+        const __m128 s1s2 = _mm_mul_ps(s1, s2);
+        const __m128 c1s2 = _mm_mul_ps(c1, s2);
+        Basis4 b;
+        b.xx = _mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(s1s2, s3));
+        b.xy = _mm_mul_ps(c2, s3);
+        b.xz = _mm_sub_ps(_mm_mul_ps(c1s2, s3), _mm_mul_ps(c3, s1));
+        b.yx = _mm_sub_ps(_mm_mul_ps(c3, s1s2), _mm_mul_ps(c1, s3));
+        b.yy = _mm_mul_ps(c2, c3);
+        b.yz = _mm_add_ps(_mm_mul_ps(c1s2, c3), _mm_mul_ps(s1, s3));
+        b.zx = _mm_mul_ps(c2, s1);
+        b.zy = _mm_sub_ps(_mm_setzero_ps(), s2);
+        b.zz = _mm_mul_ps(c1, c2);
+        return b;
+    }
+
+    static inline void storeMatrices(const Basis4 &b, const glm::vec3 *translations,
+                                     glm::mat4 *modelMatrices, glm::mat4 *normalMatrices) {
+        const __m128 zero = _mm_setzero_ps();
+        storeColumns(modelMatrices, 0, _mm_mul_ps(b.xx, b.sx), _mm_mul_ps(b.xy, b.sx), _mm_mul_ps(b.xz, b.sx), zero);
+        storeColumns(modelMatrices, 1, _mm_mul_ps(b.yx, b.sy), _mm_mul_ps(b.yy, b.sy), _mm_mul_ps(b.yz, b.sy), zero);
+        storeColumns(modelMatrices, 2, _mm_mul_ps(b.zx, b.sz), _mm_mul_ps(b.zy, b.sz), _mm_mul_ps(b.zz, b.sz), zero);
+
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 ix = _mm_div_ps(one, b.sx);
+        const __m128 iy = _mm_div_ps(one, b.sy);
+        const __m128 iz = _mm_div_ps(one, b.sz);
+        storeColumns(normalMatrices, 0, _mm_mul_ps(b.xx, ix), _mm_mul_ps(b.xy, ix), _mm_mul_ps(b.xz, ix), zero);
+        storeColumns(normalMatrices, 1, _mm_mul_ps(b.yx, iy), _mm_mul_ps(b.yy, iy), _mm_mul_ps(b.yz, iy), zero);
+        storeColumns(normalMatrices, 2, _mm_mul_ps(b.zx, iz), _mm_mul_ps(b.zy, iz), _mm_mul_ps(b.zz, iz), zero);
+
+        for (int k = 0; k < 4; k++) {
+            modelMatrices[k][3] = glm::vec4(translations[k], 1.0f);
+            normalMatrices[k][3] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        }
+    }
+
+#define ZE_GATHER4(array, i, component) \
+    _mm_setr_ps(array[i].component, array[i + 1].component, array[i + 2].component, array[i + 3].component)
+
+    static size_t composeTransformsSSE(const glm::vec3 *translations, const glm::vec3 *rotations, const glm::vec3 *scales,
+                                       glm::mat4 *modelMatrices, glm::mat4 *normalMatrices, size_t count) {
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m128 s1, c1, s2, c2, s3, c3;
+            sinCos(ZE_GATHER4(rotations, i, y), s1, c1);
+            sinCos(ZE_GATHER4(rotations, i, x), s2, c2);
+            sinCos(ZE_GATHER4(rotations, i, z), s3, c3);
+
+            Basis4 b = composeBasis(s1, c1, s2, c2, s3, c3);
+            b.sx = ZE_GATHER4(scales, i, x);
+            b.sy = ZE_GATHER4(scales, i, y);
+            b.sz = ZE_GATHER4(scales, i, z);
+            storeMatrices(b, translations + i, modelMatrices + i, normalMatrices + i);
+        }
+        return i;
+    }
+#undef ZE_GATHER4
+#endif
+
+    void composeTransforms(const glm::vec3 *translations, const glm::vec3 *rotations, const glm::vec3 *scales,
+                           glm::mat4 *modelMatrices, glm::mat4 *normalMatrices, size_t count) {
+        size_t done = 0;
+#ifdef ZE_SIMD_SSE
+        done = composeTransformsSSE(translations, rotations, scales, modelMatrices, normalMatrices, count);
+#endif
+        composeTransformsScalar(translations + done, rotations + done, scales + done,
+                                modelMatrices + done, normalMatrices + done, count - done);
+    }
+
+}
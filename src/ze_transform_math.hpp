@@ -0,0 +1,23 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cstddef>
+
+namespace ze {
+
+    // Composes count transforms from Euler angles :
+    // model = Translate * Ry * Rx * Rz * Scale, Tait-bryan angles of Y(1), X(2), Z(3)
+    // (https://en.wikipedia.org/wiki/Euler_angles#Rotation_matrix)
+    // normal = Ry * Rx * Rz * inverse(Scale), in the upper 3x3 of a mat4
+    // Four transforms at a time with SSE2 when available, the scalar version for the remainder.
+    void composeTransforms(const glm::vec3 *translations, const glm::vec3 *rotations, const glm::vec3 *scales,
+                           glm::mat4 *modelMatrices, glm::mat4 *normalMatrices, size_t count);
+
+    // reference implementation, one sin/cos per angle per transform
+    void composeTransformsScalar(const glm::vec3 *translations, const glm::vec3 *rotations, const glm::vec3 *scales,
+                                 glm::mat4 *modelMatrices, glm::mat4 *normalMatrices, size_t count);
+
+}
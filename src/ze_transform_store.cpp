@@ -0,0 +1,169 @@
+#include "ze_transform_store.hpp"
+#include "ze_transform_math.hpp"
+
+#include <algorithm>
+
+namespace ze {
+
+    void ZeTransformStore::add(id_t id) {
+        if (id >= sparse.size()) {
+            sparse.resize(id + 1, INVALID_INDEX);
+        }
+        assert(sparse[id] == INVALID_INDEX && "Transform already in store");
+        sparse[id] = static_cast<uint32_t>(ids.size());
+        ids.push_back(id);
+        translations.emplace_back(0.0f);
+        rotations.emplace_back(0.0f);
+        scales.emplace_back(1.0f);
+        parents.push_back(NO_PARENT);
+        children.emplace_back();
+        dirtyFlags.push_back(LOCAL_DIRTY | WORLD_DIRTY);
+        localMatrices.emplace_back(1.0f);
+        localNormalMatrices.emplace_back(1.0f);
+        modelMatrices.emplace_back(1.0f);
+        normalMatrices.emplace_back(1.0f);
+        dirtyIds.push_back(id);
+    }
+
+    void ZeTransformStore::remove(id_t id) {
+        // detach from the hierarchy
+        for (id_t child : std::vector<id_t>(children[indexOf(id)])) {
+            setParent(child, NO_PARENT);
+        }
+        setParent(id, NO_PARENT);
+
+        uint32_t index = indexOf(id);
+        uint32_t last = static_cast<uint32_t>(ids.size()) - 1;
+        if (index != last) {
+            ids[index] = ids[last];
+            translations[index] = translations[last];
+            rotations[index] = rotations[last];
+            scales[index] = scales[last];
+            parents[index] = parents[last];
+            children[index] = std::move(children[last]);
+            dirtyFlags[index] = dirtyFlags[last];
+            localMatrices[index] = localMatrices[last];
+            localNormalMatrices[index] = localNormalMatrices[last];
+            modelMatrices[index] = modelMatrices[last];
+            normalMatrices[index] = normalMatrices[last];
+            sparse[ids[index]] = index;
+        }
+        ids.pop_back();
+        translations.pop_back();
+        rotations.pop_back();
+        scales.pop_back();
+        parents.pop_back();
+        children.pop_back();
+        dirtyFlags.pop_back();
+        localMatrices.pop_back();
+        localNormalMatrices.pop_back();
+        modelMatrices.pop_back();
+        normalMatrices.pop_back();
+        sparse[id] = INVALID_INDEX;
+        // a stale entry in dirtyIds is skipped by updateMatrices(), ids are never reused
+    }
+
+    void ZeTransformStore::setParent(id_t id, id_t parent) {
+        uint32_t index = indexOf(id);
+        if (parents[index] == parent) {
+            return;
+        }
+        if (parents[index] != NO_PARENT) {
+            auto &siblings = children[indexOf(parents[index])];
+            siblings.erase(std::find(siblings.begin(), siblings.end(), id));
+        }
+        if (parent != NO_PARENT) {
+            for (id_t ancestor = parent; ancestor != NO_PARENT; ancestor = parents[indexOf(ancestor)]) {
+                assert(ancestor != id && "Transform hierarchy cycle");
+            }
+            children[indexOf(parent)].push_back(id);
+        }
+        parents[index] = parent;
+        // roots keep no local matrix, see updateMatrices()
+        markDirty(id);
+    }
+
+    void ZeTransformStore::markDirty(id_t id) {
+        uint8_t &flags = dirtyFlags[indexOf(id)];
+        if (flags & LOCAL_DIRTY) {
+            return;
+        }
+        if (flags == 0) {
+            dirtyIds.push_back(id);
+        }
+        flags |= LOCAL_DIRTY;
+        markWorldDirty(id);
+    }
+
+    void ZeTransformStore::markWorldDirty(id_t id) {
+        uint32_t index = indexOf(id);
+        uint8_t &flags = dirtyFlags[index];
+        if (flags & WORLD_DIRTY) {
+            // the descendants were marked with it
+            return;
+        }
+        if (flags == 0) {
+            dirtyIds.push_back(id);
+        }
+        flags |= WORLD_DIRTY;
+        for (id_t child : children[index]) {
+            markWorldDirty(child);
+        }
+    }
+
+    void ZeTransformStore::updateMatrices() {
+        lastUpdateCount = 0;
+        if (dirtyIds.empty()) {
+            return;
+        }
+
+        // local matrices, by runs of contiguous dirty transforms
+        dirtyIndices.clear();
+        for (id_t id : dirtyIds) {
+            if (contains(id) && (dirtyFlags[sparse[id]] & LOCAL_DIRTY)) {
+                dirtyIndices.push_back(sparse[id]);
+            }
+        }
+        std::sort(dirtyIndices.begin(), dirtyIndices.end());
+        for (size_t first = 0; first < dirtyIndices.size();) {
+            // the world matrices of the roots are their local ones, composed in place : only the
+            // children keep a local matrix
+            const uint32_t begin = dirtyIndices[first];
+            const bool roots = parents[begin] == NO_PARENT;
+            size_t last = first + 1;
+            while (last < dirtyIndices.size() && dirtyIndices[last] == dirtyIndices[last - 1] + 1 &&
+                   (parents[dirtyIndices[last]] == NO_PARENT) == roots) {
+                last++;
+            }
+            composeTransforms(translations.data() + begin, rotations.data() + begin, scales.data() + begin,
+                              (roots ? modelMatrices : localMatrices).data() + begin,
+                              (roots ? normalMatrices : localNormalMatrices).data() + begin,
+                              last - first);
+            first = last;
+        }
+
+        // world matrices, parents first
+        for (id_t id : dirtyIds) {
+            if (contains(id)) {
+                updateWorld(sparse[id]);
+            }
+        }
+        dirtyIds.clear();
+    }
+
+    void ZeTransformStore::updateWorld(uint32_t index) {
+        if (!(dirtyFlags[index] & WORLD_DIRTY)) {
+            return;
+        }
+        // a dirty root was composed with its local matrix
+        if (parents[index] != NO_PARENT) {
+            uint32_t parent = indexOf(parents[index]);
+            updateWorld(parent);
+            modelMatrices[index] = modelMatrices[parent] * localMatrices[index];
+            normalMatrices[index] = normalMatrices[parent] * localNormalMatrices[index];
+        }
+        dirtyFlags[index] = 0;
+        lastUpdateCount++;
+    }
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace ze {
+
+    // Structure of arrays storage for the game objects transforms : dense arrays indexed through
+    // a sparse id -> index table, so computing the matrices is a linear walk over contiguous memory.
+    // Removal swaps the last transform into the hole, dense indices are not stable.
+    //
+    // Matrices are cached : the non const accessors mark a transform dirty (and the world matrices
+    // of its descendants), updateMatrices() only recomputes the dirty ones.
+    class ZeTransformStore {
+    public:
+        using id_t = uint32_t;
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+        static constexpr id_t NO_PARENT = UINT32_MAX;
+
+        ZeTransformStore() = default;
+
+        ZeTransformStore(const ZeTransformStore&) = delete;
+        ZeTransformStore &operator=(const ZeTransformStore&) = delete;
+
+        void add(id_t id);
+        // children of the removed transform become roots
+        void remove(id_t id);
+        bool contains(id_t id) const { return id < sparse.size() && sparse[id] != INVALID_INDEX; }
+        uint32_t size() const { return static_cast<uint32_t>(ids.size()); }
+
+        glm::vec3 &translation(id_t id) { markDirty(id); return translations[indexOf(id)]; }
+        glm::vec3 &rotation(id_t id) { markDirty(id); return rotations[indexOf(id)]; }
+        glm::vec3 &scale(id_t id) { markDirty(id); return scales[indexOf(id)]; }
+        const glm::vec3 &translation(id_t id) const { return translations[indexOf(id)]; }
+        const glm::vec3 &rotation(id_t id) const { return rotations[indexOf(id)]; }
+        const glm::vec3 &scale(id_t id) const { return scales[indexOf(id)]; }
+
+        // translation, rotation and scale are relative to the parent, NO_PARENT for a root
+        void setParent(id_t id, id_t parent);
+        id_t getParent(id_t id) const { return parents[indexOf(id)]; }
+
+        // world matrices as of the last updateMatrices() call
+        const glm::mat4 &modelMatrix(id_t id) const { return modelMatrices[indexOf(id)]; }
+        // upper 3x3 is the inverse transpose of the model matrix
+        const glm::mat4 &normalMatrix(id_t id) const { return normalMatrices[indexOf(id)]; }
+
+        // recomputes the matrices of the dirty transforms, local ones in batches
+        void updateMatrices();
+        // number of world matrices recomputed by the last updateMatrices() call
+        uint32_t getLastUpdateCount() const { return lastUpdateCount; }
+
+        // dense arrays, index i of each array belongs to getIds()[i]
+        const id_t *getIds() const { return ids.data(); }
+        const glm::mat4 *getModelMatrices() const { return modelMatrices.data(); }
+        const glm::mat4 *getNormalMatrices() const { return normalMatrices.data(); }
+
+    private:
+        enum DirtyFlags : uint8_t {
+            LOCAL_DIRTY = 1,
+            WORLD_DIRTY = 2,
+        };
+
+        uint32_t indexOf(id_t id) const {
+            assert(contains(id) && "Transform not in store");
+            return sparse[id];
+        }
+        void markDirty(id_t id);
+        void markWorldDirty(id_t id);
+        void updateWorld(uint32_t index);
+
+        std::vector<uint32_t> sparse;
+        std::vector<id_t> ids;
+        std::vector<glm::vec3> translations;
+        std::vector<glm::vec3> rotations;
+        std::vector<glm::vec3> scales;
+        std::vector<id_t> parents;
+        std::vector<std::vector<id_t>> children;
+        std::vector<uint8_t> dirtyFlags;
+        // relative to the parent, unused for the roots
+        std::vector<glm::mat4> localMatrices;
+        std::vector<glm::mat4> localNormalMatrices;
+        std::vector<glm::mat4> modelMatrices;
+        std::vector<glm::mat4> normalMatrices;
+
+        // ids with dirty flags, in marking order
+        std::vector<id_t> dirtyIds;
+        std::vector<uint32_t> dirtyIndices;
+        uint32_t lastUpdateCount{0};
+    };
+
+}
@@ -0,0 +1,296 @@
+#include "ze_upload_batcher.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace ze {
+
+    // keeps every staging region aligned for the copy commands
+    static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+    ZeUploadBatcher::ZeUploadBatcher(ZeDevice &device, VkDeviceSize stagingSize): zeDevice{device} {
+        capacity = (stagingSize + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+        stagingBuffer = std::make_unique<ZeBuffer>(
+                zeDevice,
+                capacity,
+                1,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        stagingBuffer->map();
+        createCommandPool(zeDevice.transferQueueFamily(), commandPool);
+        if (zeDevice.hasDedicatedTransferQueue()) {
+            createCommandPool(zeDevice.graphicsQueueFamily(), acquireCommandPool);
+        }
+    }
+
+    ZeUploadBatcher::~ZeUploadBatcher() {
+        try {
+            flush();
+        } catch (const std::exception &e) {
+            // the copies not submitted are lost, a submission may be half done : wait for the queues
+            std::cerr << "upload batcher: " << e.what() << std::endl;
+            zeDevice.waitIdle();
+            while (!inFlight.empty()) {
+                waitOldestSubmission();
+            }
+        }
+        for (auto &submission : available) {
+            vkDestroyFence(zeDevice.device(), submission.fence, nullptr);
+            if (submission.transferDone != VK_NULL_HANDLE) {
+                vkDestroySemaphore(zeDevice.device(), submission.transferDone, nullptr);
+            }
+        }
+        // frees the command buffers
+        vkDestroyCommandPool(zeDevice.device(), commandPool, nullptr);
+        if (acquireCommandPool != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(zeDevice.device(), acquireCommandPool, nullptr);
+        }
+    }
+
+    void ZeUploadBatcher::createCommandPool(uint32_t queueFamily, VkCommandPool &pool) {
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = queueFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        if (vkCreateCommandPool(zeDevice.device(), &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload command pool");
+        }
+    }
+
+    VkCommandBuffer ZeUploadBatcher::allocateCommandBuffer(VkCommandPool pool) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = pool;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer commandBuffer;
+        if (vkAllocateCommandBuffers(zeDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate upload command buffer");
+        }
+        return commandBuffer;
+    }
+
+    void ZeUploadBatcher::upload(VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkDeviceSize dstOffset) {
+        const char *bytes = static_cast<const char *>(data);
+        if (zeDevice.hasDedicatedTransferQueue() &&
+            std::find(unreleased.begin(), unreleased.end(), dstBuffer) == unreleased.end()) {
+            unreleased.push_back(dstBuffer);
+        }
+        VkDeviceSize done = 0;
+        // uploads larger than the ring are split, submitting between the chunks
+        while (done < size) {
+            VkDeviceSize chunk = std::min(size - done, capacity);
+            VkDeviceSize offset = allocate(chunk);
+            std::memcpy(static_cast<char *>(stagingBuffer->getMappedMemory()) + offset, bytes + done, chunk);
+
+            VkBufferCopy region{};
+            region.srcOffset = offset;
+            region.dstOffset = dstOffset + done;
+            region.size = chunk;
+            pendingCopies.push_back({dstBuffer, region});
+            done += chunk;
+        }
+    }
+
+    VkDeviceSize ZeUploadBatcher::allocate(VkDeviceSize size) {
+        assert(size <= capacity && "staging allocation larger than the ring");
+        retireCompletedSubmissions();
+        while (true) {
+            if (inFlight.empty() && pendingCopies.empty()) {
+                head = 0;
+                tail = 0;
+            }
+            uint64_t position = (head + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+            if (position % capacity + size > capacity) {
+                // not enough room before the end of the ring, wrap around
+                position = (position / capacity + 1) * capacity;
+            }
+            if (position + size - tail <= capacity) {
+                head = position + size;
+                return position % capacity;
+            }
+            // the ring is full : release the oldest data, submitting the pending copies if they
+            // are what holds it
+            if (inFlight.empty()) {
+                submitCopies(false);
+            }
+            waitOldestSubmission();
+        }
+    }
+
+    void ZeUploadBatcher::submit() {
+        submitCopies(true);
+    }
+
+    void ZeUploadBatcher::submitCopies(bool releaseDestinations) {
+        const bool transferOwnership = releaseDestinations && !unreleased.empty();
+        if (pendingCopies.empty() && !transferOwnership) {
+            return;
+        }
+        retireCompletedSubmissions();
+
+        Submission submission{};
+        if (available.empty()) {
+            submission.commandBuffer = allocateCommandBuffer(commandPool);
+            VkFenceCreateInfo fenceInfo{};
+            fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+            if (vkCreateFence(zeDevice.device(), &fenceInfo, nullptr, &submission.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create upload fence");
+            }
+            if (zeDevice.hasDedicatedTransferQueue()) {
+                submission.acquireCommandBuffer = allocateCommandBuffer(acquireCommandPool);
+                VkSemaphoreCreateInfo semaphoreInfo{};
+                semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+                if (vkCreateSemaphore(zeDevice.device(), &semaphoreInfo, nullptr, &submission.transferDone) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to create upload semaphore");
+                }
+            }
+        } else {
+            submission = available.back();
+            available.pop_back();
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(submission.commandBuffer, &beginInfo);
+
+        // one vkCmdCopyBuffer per destination run, with all its regions
+        for (size_t i = 0; i < pendingCopies.size();) {
+            VkBuffer dstBuffer = pendingCopies[i].dstBuffer;
+            regions.clear();
+            for (; i < pendingCopies.size() && pendingCopies[i].dstBuffer == dstBuffer; i++) {
+                regions.push_back(pendingCopies[i].region);
+            }
+            vkCmdCopyBuffer(
+                    submission.commandBuffer,
+                    stagingBuffer->getBuffer(),
+                    dstBuffer,
+                    static_cast<uint32_t>(regions.size()),
+                    regions.data());
+        }
+
+        if (transferOwnership) {
+            recordOwnershipTransfers(submission);
+        } else if (!zeDevice.hasDedicatedTransferQueue()) {
+            // make the uploads visible to every later use on the queue
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                    VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(
+                    submission.commandBuffer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    0,
+                    1, &barrier,
+                    0, nullptr,
+                    0, nullptr);
+        }
+
+        if (vkEndCommandBuffer(submission.commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload command buffer");
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &submission.commandBuffer;
+        if (transferOwnership) {
+            // the fence goes with the acquire, which the semaphore orders after the copies
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &submission.transferDone;
+            {
+                std::lock_guard<std::mutex> lock{zeDevice.transferQueueMutex()};
+                if (vkQueueSubmit(zeDevice.transferQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+                    throw std::runtime_error("failed to submit uploads");
+                }
+            }
+
+            VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            VkSubmitInfo acquireInfo{};
+            acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            acquireInfo.waitSemaphoreCount = 1;
+            acquireInfo.pWaitSemaphores = &submission.transferDone;
+            acquireInfo.pWaitDstStageMask = &waitStage;
+            acquireInfo.commandBufferCount = 1;
+            acquireInfo.pCommandBuffers = &submission.acquireCommandBuffer;
+            std::lock_guard<std::mutex> lock{zeDevice.queueMutex()};
+            if (vkQueueSubmit(zeDevice.graphicsQueue(), 1, &acquireInfo, submission.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit upload ownership acquire");
+            }
+        } else {
+            std::lock_guard<std::mutex> lock{zeDevice.transferQueueMutex()};
+            if (vkQueueSubmit(zeDevice.transferQueue(), 1, &submitInfo, submission.fence) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit uploads");
+            }
+        }
+
+        submission.end = head;
+        inFlight.push_back(submission);
+        pendingCopies.clear();
+    }
+
+    void ZeUploadBatcher::recordOwnershipTransfers(const Submission &submission) {
+        // one barrier per destination, after its last chunk : the release also covers the copies
+        // of the earlier submissions on the transfer queue
+        barriers.clear();
+        for (VkBuffer dstBuffer : unreleased) {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |
+                                    VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+            barrier.buffer = dstBuffer;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            barriers.push_back(barrier);
+        }
+        zeDevice.recordReleaseBarriers(submission.commandBuffer, barriers, {});
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(submission.acquireCommandBuffer, &beginInfo);
+        zeDevice.recordAcquireBarriers(submission.acquireCommandBuffer, barriers, {});
+        if (vkEndCommandBuffer(submission.acquireCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload ownership acquire");
+        }
+        unreleased.clear();
+    }
+
+    void ZeUploadBatcher::flush() {
+        submit();
+        while (!inFlight.empty()) {
+            waitOldestSubmission();
+        }
+    }
+
+    void ZeUploadBatcher::waitOldestSubmission() {
+        assert(!inFlight.empty() && "no upload in flight");
+        Submission submission = inFlight.front();
+        inFlight.pop_front();
+        vkWaitForFences(zeDevice.device(), 1, &submission.fence, VK_TRUE, UINT64_MAX);
+        tail = submission.end;
+        recycle(submission);
+    }
+
+    void ZeUploadBatcher::retireCompletedSubmissions() {
+        while (!inFlight.empty() && vkGetFenceStatus(zeDevice.device(), inFlight.front().fence) == VK_SUCCESS) {
+            tail = inFlight.front().end;
+            recycle(inFlight.front());
+            inFlight.pop_front();
+        }
+    }
+
+    void ZeUploadBatcher::recycle(const Submission &submission) {
+        vkResetFences(zeDevice.device(), 1, &submission.fence);
+        available.push_back(submission);
+    }
+
+}
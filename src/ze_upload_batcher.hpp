@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ze_device.hpp"
+#include "ze_buffer.hpp"
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace ze {
+
+    // Batches buffer uploads : data is copied into a persistently mapped staging ring right away
+    // and the GPU copies are recorded into a single command buffer per submit, fenced instead of
+    // draining the queue. The copies run on the device transfer queue; when it is a dedicated one
+    // the destinations are released to the graphics family there and acquired by a small
+    // graphics submission waiting on a semaphore, so frame submissions never wait for the copies.
+    // Not thread safe, use one batcher per thread.
+    class ZeUploadBatcher {
+    public:
+        static constexpr VkDeviceSize DEFAULT_STAGING_SIZE = 32 * 1024 * 1024;
+
+        explicit ZeUploadBatcher(ZeDevice &device, VkDeviceSize stagingSize = DEFAULT_STAGING_SIZE);
+        // flushes, an error is reported to std::cerr rather than thrown : call flush() first to handle it
+        ~ZeUploadBatcher();
+
+        ZeUploadBatcher(const ZeUploadBatcher&) = delete;
+        ZeUploadBatcher &operator=(const ZeUploadBatcher&) = delete;
+
+        // data can be released on return, dstBuffer content is valid once flushed. dstBuffer must
+        // not have been used on the graphics queue yet, see ZeDevice::copyBuffer : with a dedicated
+        // transfer queue, uploading again to a destination of an earlier submit() keeps only the
+        // newly written ranges
+        void upload(VkBuffer dstBuffer, const void *data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+
+        // submits the pending copies without waiting for them, and hands their destinations over
+        // to the graphics queue
+        void submit();
+        // submits the pending copies and waits until every upload is complete
+        void flush();
+
+        bool hasPendingCopies() const { return !pendingCopies.empty(); }
+
+    private:
+        struct PendingCopy {
+            VkBuffer dstBuffer;
+            VkBufferCopy region;
+        };
+
+        struct Submission {
+            VkCommandBuffer commandBuffer;
+            // ownership acquire on the graphics queue, only with a dedicated transfer queue
+            VkCommandBuffer acquireCommandBuffer;
+            // binary : signaled by one transfer submission and waited on once by its acquire, the
+            // frame timeline semaphore stays reserved to the graphics queue frame pacing
+            VkSemaphore transferDone;
+            VkFence fence;
+            uint64_t end; // ring position released once the fence signals
+        };
+
+        void createCommandPool(uint32_t queueFamily, VkCommandPool &pool);
+        VkCommandBuffer allocateCommandBuffer(VkCommandPool pool);
+        // releaseDestinations is false for the submits made while the ring is full, the
+        // destinations stay on the transfer queue until every chunk of them is copied
+        void submitCopies(bool releaseDestinations);
+        void recordOwnershipTransfers(const Submission &submission);
+        VkDeviceSize allocate(VkDeviceSize size);
+        void waitOldestSubmission();
+        void retireCompletedSubmissions();
+        void recycle(const Submission &submission);
+
+        ZeDevice &zeDevice;
+        std::unique_ptr<ZeBuffer> stagingBuffer;
+        VkDeviceSize capacity;
+
+        // monotonic positions in the ring, the physical offset is position % capacity
+        uint64_t head{0};
+        uint64_t tail{0};
+
+        VkCommandPool commandPool;
+        VkCommandPool acquireCommandPool = VK_NULL_HANDLE;
+        std::vector<PendingCopy> pendingCopies;
+        // destinations copied to and not yet released, only with a dedicated transfer queue
+        std::vector<VkBuffer> unreleased;
+        std::vector<VkBufferCopy> regions;
+        std::vector<VkBufferMemoryBarrier> barriers;
+        std::deque<Submission> inFlight;
+        std::vector<Submission> available;
+    };
+
+}
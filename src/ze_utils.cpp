@@ -0,0 +1,29 @@
+#include "ze_utils.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+
+namespace ze {
+
+    std::string uniqueTemporaryPath(const std::string &path) {
+        static std::atomic<uint32_t> counter{0};
+        static const uint32_t processToken = std::random_device{}();
+#ifdef _WIN32
+        const unsigned long processId = GetCurrentProcessId();
+#else
+        const unsigned long processId = static_cast<unsigned long>(getpid());
+#endif
+        return path + "." + std::to_string(processId) + "." + std::to_string(processToken) + "." +
+               std::to_string(counter.fetch_add(1, std::memory_order_relaxed)) + ".tmp";
+    }
+
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdio>
 #include <functional>
+#include <string>
 
 namespace ze {
 
@@ -11,4 +13,26 @@ namespace ze {
         (hashCombine(seed, rest), ...);
     };
 
+    // quoted JSON string, with the quotes, backslashes and control characters escaped
+    inline std::string jsonString(const std::string &value) {
+        std::string quoted{"\""};
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+                quoted += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[7];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+                quoted += escaped;
+            } else {
+                quoted += c;
+            }
+        }
+        return quoted + '"';
+    }
+
+    // path with a suffix unique to the process and the call, for a file written aside then renamed
+    // over path : writers of the same file, in this process or another one, each rename their own
+    std::string uniqueTemporaryPath(const std::string &path);
+
 }
\ No newline at end of file